@@ -1,11 +1,15 @@
 //http://lazyfoo.net/tutorials/SDL/03_event_driven_programming/index.php
 #include <SDL.h>
 #include <stdio.h>
+#include <vector>
 #include <string>
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Dirty rects tracked before they are collapsed into one
+const int MAX_DIRTY_RECTS = 16;
+
 //Key press surface constants
 enum KeyPressSurfaces
 {
@@ -26,6 +30,12 @@ bool loadMedia();
 //Frees media and shuts down SDL
 void close();
 
+//Marks an area of the screen surface as changed
+void addDirtyRect(SDL_Rect rect);
+
+//Pushes the changed areas to the window
+void updateDirtyRects();
+
 //Loads individual image
 SDL_Surface* loadSurface( std::string path );
 
@@ -35,6 +45,9 @@ SDL_Window* gWindow = NULL;
 //The surface contained by the window
 SDL_Surface* gScreenSurface = NULL;
 
+//Changed areas of the screen surface since the last update
+std::vector<SDL_Rect> gDirtyRects;
+
 //The images that correspond to a keypress
 SDL_Surface* gKeyPressSurfaces[ KEY_PRESS_SURFACE_TOTAL ];
 
@@ -147,6 +160,61 @@ SDL_Surface* loadSurface(std::string path)
 	return loadedSurface;
 }
 	
+void addDirtyRect(SDL_Rect rect)
+{
+	//Only the part on screen matters
+	SDL_Rect screen = {0, 0, gScreenSurface->w, gScreenSurface->h};
+	SDL_Rect dirty;
+	if(!SDL_IntersectRect(&rect, &screen, &dirty))
+	{
+		return;
+	}
+
+	//Fold in every rect it overlaps so the list stays disjoint
+	for(size_t i = 0; i < gDirtyRects.size();)
+	{
+		if(SDL_HasIntersection(&dirty, &gDirtyRects[i]))
+		{
+			SDL_Rect merged;
+			SDL_UnionRect(&dirty, &gDirtyRects[i], &merged);
+			dirty = merged;
+
+			//The grown rect may now overlap ones already checked
+			gDirtyRects[i] = gDirtyRects.back();
+			gDirtyRects.pop_back();
+			i = 0;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	gDirtyRects.push_back(dirty);
+
+	//Past a point one bigger update is cheaper than many small ones
+	if((int)gDirtyRects.size() > MAX_DIRTY_RECTS)
+	{
+		SDL_Rect bounds = gDirtyRects[0];
+		for(size_t i = 1; i < gDirtyRects.size(); ++i)
+		{
+			SDL_Rect merged;
+			SDL_UnionRect(&bounds, &gDirtyRects[i], &merged);
+			bounds = merged;
+		}
+		gDirtyRects.assign(1, bounds);
+	}
+}
+
+void updateDirtyRects()
+{
+	//Copy only the changed areas to the window
+	if(!gDirtyRects.empty())
+	{
+		SDL_UpdateWindowSurfaceRects(gWindow, &gDirtyRects[0], (int)gDirtyRects.size());
+		gDirtyRects.clear();
+	}
+}
+
 int wmain(int argc, char* args[])
 {
 	
@@ -170,6 +238,9 @@ int wmain(int argc, char* args[])
 		
 		//Set default current surface
 		gCurrentSurface = gKeyPressSurfaces[ KEY_PRESS_SURFACE_DEFAULT ];
+		
+		//Image last applied to the screen
+		SDL_Surface* appliedSurface = NULL;
 
 		//While application is running
 		while( !quit )
@@ -182,6 +253,12 @@ int wmain(int argc, char* args[])
 				{
 					quit = true;
 				}
+				//Window needs its contents again
+				else if( e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED )
+				{
+					SDL_Rect screen = { 0, 0, gScreenSurface->w, gScreenSurface->h };
+					addDirtyRect( screen );
+				}
 				//User presses a key
 				else if( e.type == SDL_KEYDOWN )
 				{
@@ -211,10 +288,18 @@ int wmain(int argc, char* args[])
 				}
 			}
 			
-			//Apply the image
-			SDL_BlitSurface(gCurrentSurface, NULL, gScreenSurface, NULL);
-			//Update the surface
-			SDL_UpdateWindowSurface(gWindow);
+			//Apply the image only when a key changed it
+			if( gCurrentSurface != appliedSurface )
+			{
+				//The blit fills in the area it covered
+				SDL_Rect imageRect = { 0, 0, 0, 0 };
+				SDL_BlitSurface(gCurrentSurface, NULL, gScreenSurface, &imageRect);
+				addDirtyRect(imageRect);
+				appliedSurface = gCurrentSurface;
+			}
+			
+			//Update only what changed
+			updateDirtyRects();
 		}
 		
 	}
@@ -5,12 +5,16 @@ and may not be redistributed without written permission.*/
 #include <SDL.h>
 #include <SDL_image.h>
 #include <stdio.h>
+#include <vector>
 #include <string>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Dirty rects tracked before they are collapsed into one
+const int MAX_DIRTY_RECTS = 16;
+
 //Starts up SDL and creates window
 bool init();
 
@@ -20,6 +24,12 @@ bool loadMedia();
 //Frees media and shuts down SDL
 void close();
 
+//Marks an area of the screen surface as changed
+void addDirtyRect(SDL_Rect rect);
+
+//Pushes the changed areas to the window
+void updateDirtyRects();
+
 //Loads individual image
 SDL_Surface* loadSurface( std::string path );
 
@@ -29,6 +39,9 @@ SDL_Window* gWindow = NULL;
 //The surface contained by the window
 SDL_Surface* gScreenSurface = NULL;
 
+//Changed areas of the screen surface since the last update
+std::vector<SDL_Rect> gDirtyRects;
+
 //Current displayed PNG image
 SDL_Surface* gPNGSurface = NULL;
 
@@ -130,6 +143,61 @@ SDL_Surface* loadSurface( std::string path )
 	return optimizedSurface;
 }
 
+void addDirtyRect(SDL_Rect rect)
+{
+	//Only the part on screen matters
+	SDL_Rect screen = {0, 0, gScreenSurface->w, gScreenSurface->h};
+	SDL_Rect dirty;
+	if(!SDL_IntersectRect(&rect, &screen, &dirty))
+	{
+		return;
+	}
+
+	//Fold in every rect it overlaps so the list stays disjoint
+	for(size_t i = 0; i < gDirtyRects.size();)
+	{
+		if(SDL_HasIntersection(&dirty, &gDirtyRects[i]))
+		{
+			SDL_Rect merged;
+			SDL_UnionRect(&dirty, &gDirtyRects[i], &merged);
+			dirty = merged;
+
+			//The grown rect may now overlap ones already checked
+			gDirtyRects[i] = gDirtyRects.back();
+			gDirtyRects.pop_back();
+			i = 0;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	gDirtyRects.push_back(dirty);
+
+	//Past a point one bigger update is cheaper than many small ones
+	if((int)gDirtyRects.size() > MAX_DIRTY_RECTS)
+	{
+		SDL_Rect bounds = gDirtyRects[0];
+		for(size_t i = 1; i < gDirtyRects.size(); ++i)
+		{
+			SDL_Rect merged;
+			SDL_UnionRect(&bounds, &gDirtyRects[i], &merged);
+			bounds = merged;
+		}
+		gDirtyRects.assign(1, bounds);
+	}
+}
+
+void updateDirtyRects()
+{
+	//Copy only the changed areas to the window
+	if(!gDirtyRects.empty())
+	{
+		SDL_UpdateWindowSurfaceRects(gWindow, &gDirtyRects[0], (int)gDirtyRects.size());
+		gDirtyRects.clear();
+	}
+}
+
 int wmain( int argc, char* args[] )
 {
 	//Start up SDL and create window
@@ -152,6 +220,11 @@ int wmain( int argc, char* args[] )
 			//Event handler
 			SDL_Event e;
 
+			//Apply the PNG image once, the blit fills in the area it covered
+			SDL_Rect imageRect = { 0, 0, 0, 0 };
+			SDL_BlitSurface( gPNGSurface, NULL, gScreenSurface, &imageRect );
+			addDirtyRect( imageRect );
+
 			//While application is running
 			while( !quit )
 			{
@@ -163,13 +236,16 @@ int wmain( int argc, char* args[] )
 					{
 						quit = true;
 					}
+					//Window needs its contents again
+					else if( e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED )
+					{
+						SDL_Rect screen = { 0, 0, gScreenSurface->w, gScreenSurface->h };
+						addDirtyRect( screen );
+					}
 				}
 
-				//Apply the PNG image
-				SDL_BlitSurface( gPNGSurface, NULL, gScreenSurface, NULL );
-			
-				//Update the surface
-				SDL_UpdateWindowSurface( gWindow );
+				//Update only what changed
+				updateDirtyRects();
 			}
 		}
 	}
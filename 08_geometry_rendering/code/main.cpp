@@ -1,16 +1,77 @@
 /*This source code copyrighted by Lazy Foo' Productions (2004-2015)
 and may not be redistributed without written permission.*/
 
-//Using SDL, SDL_image, standard IO, and strings
+//Using SDL, SDL_image, standard IO, strings, and string streams
 #include <SDL.h>
 #include <SDL_image.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Primitive benchmark size
+const int BENCHMARK_PRIMITIVES = 100000;
+const int BENCHMARK_FRAMES = 20;
+
+//Most colors a batch holds before it flushes to make room for new ones
+const int MAX_BATCH_COLORS = 64;
+
+//Collects primitives and draws them with one call per color and kind
+class LPrimitiveBatch
+{
+	public:
+		//Initializes variables
+		LPrimitiveBatch();
+
+		//Sets the color for primitives added after this
+		void setColor(Uint8 red, Uint8 green, Uint8 blue, Uint8 alpha = 0xFF);
+
+		//Adds primitives in the current color
+		void addPoint(int x, int y);
+		void addLine(int x1, int y1, int x2, int y2);
+		void addFillRect(SDL_Rect& rect);
+		void addRect(SDL_Rect& rect);
+
+		//Draws everything color by color and empties the batch
+		void flush();
+
+		//Gets the number of primitives waiting to be drawn
+		int getSize();
+
+	private:
+		//The primitives of one color
+		struct Bucket
+		{
+			//The draw color
+			Uint8 r, g, b, a;
+
+			//Single pixels
+			std::vector<SDL_Point> points;
+
+			//Connected line strips and how many points each has
+			std::vector<SDL_Point> lineStrips;
+			std::vector<int> lineStripCounts;
+
+			//Filled rects, also used for axis aligned lines and outlines
+			std::vector<SDL_Rect> fillRects;
+		};
+
+		//Buckets in the order their colors were first used, kept between flushes while their color is in use
+		std::vector<Bucket> mBuckets;
+
+		//Bucket new primitives go into
+		int mCurrent;
+
+		//Primitives waiting to be drawn
+		int mSize;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -23,6 +84,9 @@ void close();
 //Loads individual image as texture
 SDL_Texture* loadTexture( std::string path );
 
+//Times drawing many primitives one call at a time against the batch
+void runPrimitiveBenchmark();
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -32,6 +96,182 @@ SDL_Renderer* gRenderer = NULL;
 //Current displayed texture
 SDL_Texture* gTexture = NULL;
 
+//Batch for the scene's shapes
+LPrimitiveBatch gPrimitives;
+
+LPrimitiveBatch::LPrimitiveBatch()
+{
+	//Draw white until told otherwise
+	mCurrent = -1;
+	mSize = 0;
+	setColor(0xFF, 0xFF, 0xFF);
+}
+
+void LPrimitiveBatch::setColor(Uint8 red, Uint8 green, Uint8 blue, Uint8 alpha)
+{
+	//Reuse the bucket for this color if there is one
+	for(int i = 0; i < (int)mBuckets.size(); ++i)
+	{
+		Bucket& bucket = mBuckets[i];
+		if(bucket.r == red && bucket.g == green && bucket.b == blue && bucket.a == alpha)
+		{
+			mCurrent = i;
+			return;
+		}
+	}
+
+	//Out of room, draw what is waiting and start over with just this color
+	if((int)mBuckets.size() >= MAX_BATCH_COLORS)
+	{
+		flush();
+		mBuckets.clear();
+	}
+
+	mBuckets.push_back(Bucket());
+	mCurrent = (int)mBuckets.size() - 1;
+	mBuckets[mCurrent].r = red;
+	mBuckets[mCurrent].g = green;
+	mBuckets[mCurrent].b = blue;
+	mBuckets[mCurrent].a = alpha;
+}
+
+void LPrimitiveBatch::addPoint(int x, int y)
+{
+	SDL_Point point = {x, y};
+	mBuckets[mCurrent].points.push_back(point);
+	++mSize;
+}
+
+void LPrimitiveBatch::addLine(int x1, int y1, int x2, int y2)
+{
+	Bucket& bucket = mBuckets[mCurrent];
+	++mSize;
+
+	//Axis aligned lines are one pixel thick rects
+	if(x1 == x2 || y1 == y2)
+	{
+		SDL_Rect rect = {SDL_min(x1, x2), SDL_min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1};
+		bucket.fillRects.push_back(rect);
+		return;
+	}
+
+	//Continue the last strip if this line starts where it ended
+	SDL_Point end = {x2, y2};
+	if(!bucket.lineStrips.empty() && bucket.lineStrips.back().x == x1 && bucket.lineStrips.back().y == y1)
+	{
+		bucket.lineStrips.push_back(end);
+		++bucket.lineStripCounts.back();
+	}
+	else
+	{
+		SDL_Point start = {x1, y1};
+		bucket.lineStrips.push_back(start);
+		bucket.lineStrips.push_back(end);
+		bucket.lineStripCounts.push_back(2);
+	}
+}
+
+void LPrimitiveBatch::addFillRect(SDL_Rect& rect)
+{
+	mBuckets[mCurrent].fillRects.push_back(rect);
+	++mSize;
+}
+
+void LPrimitiveBatch::addRect(SDL_Rect& rect)
+{
+	if(rect.w <= 0 || rect.h <= 0)
+	{
+		return;
+	}
+
+	//Outline as the four edges, the same pixels SDL_RenderDrawRect touches
+	Bucket& bucket = mBuckets[mCurrent];
+	SDL_Rect top = {rect.x, rect.y, rect.w, 1};
+	SDL_Rect bottom = {rect.x, rect.y + rect.h - 1, rect.w, 1};
+	SDL_Rect left = {rect.x, rect.y + 1, 1, rect.h - 2};
+	SDL_Rect right = {rect.x + rect.w - 1, rect.y + 1, 1, rect.h - 2};
+	bucket.fillRects.push_back(top);
+	if(rect.h > 1)
+	{
+		bucket.fillRects.push_back(bottom);
+	}
+	if(rect.h > 2)
+	{
+		bucket.fillRects.push_back(left);
+		if(rect.w > 1)
+		{
+			bucket.fillRects.push_back(right);
+		}
+	}
+	++mSize;
+}
+
+void LPrimitiveBatch::flush()
+{
+	int kept = 0;
+	for(int i = 0; i < (int)mBuckets.size(); ++i)
+	{
+		//Colors left unused since the last flush are dropped, except the current one
+		Bucket& bucket = mBuckets[i];
+		if(bucket.points.empty() && bucket.lineStrips.empty() && bucket.fillRects.empty())
+		{
+			if(i == mCurrent)
+			{
+				if(kept != i)
+				{
+					std::swap(mBuckets[kept], bucket);
+				}
+				mCurrent = kept++;
+			}
+			continue;
+		}
+
+		//One color change per bucket
+		SDL_SetRenderDrawColor(gRenderer, bucket.r, bucket.g, bucket.b, bucket.a);
+
+		//Areas first so thin primitives stay on top of them
+		if(!bucket.fillRects.empty())
+		{
+			SDL_RenderFillRects(gRenderer, &bucket.fillRects[0], (int)bucket.fillRects.size());
+		}
+
+		//One call per strip
+		int first = 0;
+		for(size_t j = 0; j < bucket.lineStripCounts.size(); ++j)
+		{
+			SDL_RenderDrawLines(gRenderer, &bucket.lineStrips[first], bucket.lineStripCounts[j]);
+			first += bucket.lineStripCounts[j];
+		}
+
+		if(!bucket.points.empty())
+		{
+			SDL_RenderDrawPoints(gRenderer, &bucket.points[0], (int)bucket.points.size());
+		}
+
+		//Empty but keep the memory for next frame
+		bucket.points.clear();
+		bucket.lineStrips.clear();
+		bucket.lineStripCounts.clear();
+		bucket.fillRects.clear();
+		if(i == mCurrent)
+		{
+			mCurrent = kept;
+		}
+		if(kept != i)
+		{
+			std::swap(mBuckets[kept], bucket);
+		}
+		++kept;
+	}
+	mBuckets.resize(kept);
+	mSize = 0;
+}
+
+int LPrimitiveBatch::getSize()
+{
+	return mSize;
+}
+
 bool init()
 {
 	//Initialization flag
@@ -133,6 +373,76 @@ void close()
 	SDL_Quit();
 }
 
+void runPrimitiveBenchmark()
+{
+	//Random small primitives in a handful of colors
+	const Uint8 palette[][3] = { {0xFF, 0, 0}, {0, 0xFF, 0}, {0, 0, 0xFF}, {0xFF, 0xFF, 0}, {0xFF, 0, 0xFF}, {0, 0xFF, 0xFF}, {0x80, 0x80, 0x80}, {0, 0, 0} };
+	const int totalColors = sizeof(palette) / sizeof(palette[0]);
+	std::vector<SDL_Rect> rects(BENCHMARK_PRIMITIVES);
+	std::vector<int> colors(BENCHMARK_PRIMITIVES);
+	for(int i = 0; i < BENCHMARK_PRIMITIVES; ++i)
+	{
+		rects[i].x = rand() % SCREEN_WIDTH;
+		rects[i].y = rand() % SCREEN_HEIGHT;
+		rects[i].w = (i % 2 == 0) ? 1 : 1 + rand() % 4;
+		rects[i].h = (i % 2 == 0) ? 1 : 1 + rand() % 4;
+		colors[i] = rand() % totalColors;
+	}
+
+	//One draw call and color change per primitive
+	Uint64 start = SDL_GetPerformanceCounter();
+	for(int frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+	{
+		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+		SDL_RenderClear(gRenderer);
+		for(int i = 0; i < BENCHMARK_PRIMITIVES; ++i)
+		{
+			SDL_SetRenderDrawColor(gRenderer, palette[colors[i]][0], palette[colors[i]][1], palette[colors[i]][2], 0xFF);
+			if(rects[i].w == 1 && rects[i].h == 1)
+			{
+				SDL_RenderDrawPoint(gRenderer, rects[i].x, rects[i].y);
+			}
+			else
+			{
+				SDL_RenderFillRect(gRenderer, &rects[i]);
+			}
+		}
+		SDL_RenderPresent(gRenderer);
+	}
+	double immediateTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() / BENCHMARK_FRAMES;
+
+	//The same primitives through the batch
+	LPrimitiveBatch batch;
+	start = SDL_GetPerformanceCounter();
+	for(int frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+	{
+		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+		SDL_RenderClear(gRenderer);
+		for(int i = 0; i < BENCHMARK_PRIMITIVES; ++i)
+		{
+			batch.setColor(palette[colors[i]][0], palette[colors[i]][1], palette[colors[i]][2]);
+			if(rects[i].w == 1 && rects[i].h == 1)
+			{
+				batch.addPoint(rects[i].x, rects[i].y);
+			}
+			else
+			{
+				batch.addFillRect(rects[i]);
+			}
+		}
+		batch.flush();
+		SDL_RenderPresent(gRenderer);
+	}
+	double batchedTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() / BENCHMARK_FRAMES;
+
+	printf("%d primitives: immediate %.3f ms per frame, batched %.3f ms per frame, %.2fx speedup\n", BENCHMARK_PRIMITIVES, immediateTime, batchedTime, immediateTime / batchedTime);
+
+	//Show the results where a windowed build can see them
+	std::stringstream caption;
+	caption << BENCHMARK_PRIMITIVES << " primitives: immediate=" << immediateTime << "ms batched=" << batchedTime << "ms";
+	SDL_SetWindowTitle(gWindow, caption.str().c_str());
+}
+
 int wmain( int argc, char* args[] )
 {
 	//Start up SDL and create window
@@ -166,6 +476,12 @@ int wmain( int argc, char* args[] )
 					{
 						quit = true;
 					}
+					
+					//Run the primitive benchmark on B
+					if( e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_b )
+					{
+						runPrimitiveBenchmark();
+					}
 				}
 
 				//Clear screen
@@ -175,27 +491,30 @@ int wmain( int argc, char* args[] )
 				//Render red filled quad
 				SDL_Rect fillRect = {SCREEN_WIDTH/4, SCREEN_HEIGHT/4, 
 					SCREEN_WIDTH/2, SCREEN_HEIGHT/2};
-				SDL_SetRenderDrawColor(gRenderer, 0x00, 0xFF, 0xFF, 0xFF);
-				SDL_RenderFillRect(gRenderer, &fillRect);
+				gPrimitives.setColor(0x00, 0xFF, 0xFF);
+				gPrimitives.addFillRect(fillRect);
 				
 				//Render green outlined quad
 				SDL_Rect outlineRect = {SCREEN_WIDTH/6, SCREEN_HEIGHT/6, 
 					SCREEN_WIDTH*2/3, SCREEN_HEIGHT*2/3};
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0x00, 0xFF, 0xFF);
-				SDL_RenderDrawRect(gRenderer, &outlineRect);
+				gPrimitives.setColor(0xFF, 0x00, 0xFF);
+				gPrimitives.addRect(outlineRect);
 				
 				//Draw blue horizontal line
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0x00, 0xFF);
-				SDL_RenderDrawLine(gRenderer,0, SCREEN_HEIGHT/2, SCREEN_WIDTH, 
+				gPrimitives.setColor(0xFF, 0xFF, 0x00);
+				gPrimitives.addLine(0, SCREEN_HEIGHT/2, SCREEN_WIDTH, 
 					SCREEN_HEIGHT/2);
 				
 				//Draw vertical line of yellow dots
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0x00, 0x00, 0xFF);
+				gPrimitives.setColor(0xFF, 0x00, 0x00);
 				for(int i = 0; i < SCREEN_HEIGHT; i += 4)
 				{
-					SDL_RenderDrawPoint(gRenderer, SCREEN_WIDTH/2, i);
+					gPrimitives.addPoint(SCREEN_WIDTH/2, i);
 				}
 				
+				//Draw the shapes with one call per color and kind
+				gPrimitives.flush();
+				
 				//Update screen
 				SDL_RenderPresent(gRenderer);
 			}
@@ -1,16 +1,106 @@
 /*This source code copyrighted by Lazy Foo' Productions (2004-2015)
 and may not be redistributed without written permission.*/
 
-//Using SDL, SDL_image, standard IO, and strings
+//Using SDL, SDL_image, standard IO, math, strings, and vectors
 #include <SDL.h>
 #include <SDL_image.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
 #include <string>
+#include <vector>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//World and scene constants
+const int WORLD_WIDTH = 4096;
+const int WORLD_HEIGHT = 4096;
+const int SCENE_CELL_SIZE = 256;
+const int SCENE_OBJECTS = 5000;
+const int OBJECT_SIZE = 48;
+
+//Viewport constants
+const int MAX_VIEWPORTS = 32;
+const int MINIMAP_SIZE = 160;
+const int CAMERA_ORBIT = 1200;
+
+//A static scene bucketed into a uniform grid
+class LScene
+{
+	public:
+		//Initializes variables
+		LScene();
+
+		//Scatters objects across the world and buckets them by cell
+		void generate(int count);
+
+		//Gets the objects whose top left corner lies in a cell
+		std::vector<int>& getCell(int x, int y);
+
+		//Gets an object's world box
+		SDL_Rect& getObject(int index);
+
+		//Gets grid dimensions
+		int getCellsAcross();
+		int getCellsDown();
+
+	private:
+		//Object boxes in world space
+		std::vector<SDL_Rect> mObjects;
+
+		//Object indices per cell
+		std::vector< std::vector<int> > mCells;
+
+		//Grid dimensions
+		int mCellsAcross;
+		int mCellsDown;
+};
+
+//A screen region showing the world through its own camera
+struct Viewport
+{
+	//Where on screen it goes
+	SDL_Rect screen;
+
+	//What part of the world it shows, scaled to fit the screen rect
+	SDL_Rect camera;
+
+	//Objects that passed culling this frame
+	std::vector<int> visible;
+};
+
+//Draws a scene into any number of viewports
+class LViewportManager
+{
+	public:
+		//Adds a viewport and returns its index, -1 if full
+		int add(SDL_Rect screen, SDL_Rect camera);
+
+		//Removes every viewport
+		void clear();
+
+		//Centers a viewport's camera on a world point, clamped to the world
+		void centerCamera(int index, int x, int y);
+
+		//Gets the number of viewports
+		int getCount();
+
+		//Culls the scene for every viewport in one shared traversal
+		void cull(LScene& scene);
+
+		//Draws each viewport's visible objects with a texture
+		void render(LScene& scene, SDL_Texture* texture);
+
+	private:
+		//The viewports in draw order
+		std::vector<Viewport> mViewports;
+
+		//Which viewports see each grid cell, one bit per viewport
+		std::vector<Uint32> mCellMasks;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -23,6 +113,9 @@ void close();
 //Loads individual image as texture
 SDL_Texture* loadTexture( std::string path );
 
+//Splits the screen between players with an optional minimap
+void setLayout(int players, bool minimap);
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -32,6 +125,175 @@ SDL_Renderer* gRenderer = NULL;
 //Current displayed texture
 SDL_Texture* gTexture = NULL;
 
+//The world and the views into it
+LScene gScene;
+LViewportManager gViewports;
+int gPlayers = 0;
+
+LScene::LScene()
+{
+	//Initialize
+	mCellsAcross = 0;
+	mCellsDown = 0;
+}
+
+void LScene::generate(int count)
+{
+	//Size the grid to the world
+	mCellsAcross = (WORLD_WIDTH + SCENE_CELL_SIZE - 1) / SCENE_CELL_SIZE;
+	mCellsDown = (WORLD_HEIGHT + SCENE_CELL_SIZE - 1) / SCENE_CELL_SIZE;
+	mCells.assign(mCellsAcross * mCellsDown, std::vector<int>());
+	mObjects.resize(count);
+
+	for(int i = 0; i < count; ++i)
+	{
+		//Random spot fully inside the world
+		SDL_Rect& box = mObjects[i];
+		box.w = OBJECT_SIZE;
+		box.h = OBJECT_SIZE;
+		box.x = rand() % (WORLD_WIDTH - OBJECT_SIZE);
+		box.y = rand() % (WORLD_HEIGHT - OBJECT_SIZE);
+
+		//Bucket by top left corner so each object lives in exactly one cell
+		mCells[(box.y / SCENE_CELL_SIZE) * mCellsAcross + box.x / SCENE_CELL_SIZE].push_back(i);
+	}
+}
+
+std::vector<int>& LScene::getCell(int x, int y)
+{
+	return mCells[y * mCellsAcross + x];
+}
+
+SDL_Rect& LScene::getObject(int index)
+{
+	return mObjects[index];
+}
+
+int LScene::getCellsAcross()
+{
+	return mCellsAcross;
+}
+
+int LScene::getCellsDown()
+{
+	return mCellsDown;
+}
+
+int LViewportManager::add(SDL_Rect screen, SDL_Rect camera)
+{
+	//Visibility masks have one bit per viewport
+	if((int)mViewports.size() >= MAX_VIEWPORTS)
+	{
+		printf("Unable to add more than %d viewports!\n", MAX_VIEWPORTS);
+		return -1;
+	}
+
+	Viewport viewport;
+	viewport.screen = screen;
+	viewport.camera = camera;
+	mViewports.push_back(viewport);
+	return (int)mViewports.size() - 1;
+}
+
+void LViewportManager::clear()
+{
+	mViewports.clear();
+}
+
+void LViewportManager::centerCamera(int index, int x, int y)
+{
+	SDL_Rect& camera = mViewports[index].camera;
+	camera.x = SDL_max(0, SDL_min(x - camera.w / 2, WORLD_WIDTH - camera.w));
+	camera.y = SDL_max(0, SDL_min(y - camera.h / 2, WORLD_HEIGHT - camera.h));
+}
+
+int LViewportManager::getCount()
+{
+	return (int)mViewports.size();
+}
+
+void LViewportManager::cull(LScene& scene)
+{
+	int across = scene.getCellsAcross();
+	int down = scene.getCellsDown();
+	mCellMasks.assign(across * down, 0);
+
+	//Mark the cells each camera touches
+	for(int i = 0; i < (int)mViewports.size(); ++i)
+	{
+		Viewport& viewport = mViewports[i];
+		viewport.visible.clear();
+
+		//Objects are bucketed by top left corner so look one object further up and left
+		SDL_Rect& camera = viewport.camera;
+		int x1 = SDL_max((camera.x - OBJECT_SIZE) / SCENE_CELL_SIZE, 0);
+		int y1 = SDL_max((camera.y - OBJECT_SIZE) / SCENE_CELL_SIZE, 0);
+		int x2 = SDL_min((camera.x + camera.w - 1) / SCENE_CELL_SIZE, across - 1);
+		int y2 = SDL_min((camera.y + camera.h - 1) / SCENE_CELL_SIZE, down - 1);
+		for(int y = y1; y <= y2; ++y)
+		{
+			for(int x = x1; x <= x2; ++x)
+			{
+				mCellMasks[y * across + x] |= 1u << i;
+			}
+		}
+	}
+
+	//Walk each touched cell once no matter how many viewports see it
+	for(int cell = 0; cell < across * down; ++cell)
+	{
+		Uint32 mask = mCellMasks[cell];
+		if(mask == 0)
+		{
+			continue;
+		}
+
+		std::vector<int>& objects = scene.getCell(cell % across, cell / across);
+		for(size_t j = 0; j < objects.size(); ++j)
+		{
+			SDL_Rect& box = scene.getObject(objects[j]);
+			for(int i = 0; i < (int)mViewports.size(); ++i)
+			{
+				if((mask & (1u << i)) && SDL_HasIntersection(&box, &mViewports[i].camera))
+				{
+					mViewports[i].visible.push_back(objects[j]);
+				}
+			}
+		}
+	}
+}
+
+void LViewportManager::render(LScene& scene, SDL_Texture* texture)
+{
+	for(size_t i = 0; i < mViewports.size(); ++i)
+	{
+		Viewport& viewport = mViewports[i];
+		SDL_Rect& camera = viewport.camera;
+		SDL_Rect& screen = viewport.screen;
+		SDL_RenderSetViewport(gRenderer, &screen);
+
+		//Background so overlapping viewports cover what is under them
+		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+		SDL_RenderFillRect(gRenderer, NULL);
+
+		//Visible objects scaled from camera to screen
+		for(size_t j = 0; j < viewport.visible.size(); ++j)
+		{
+			SDL_Rect& box = scene.getObject(viewport.visible[j]);
+			SDL_Rect renderQuad = {(box.x - camera.x) * screen.w / camera.w, (box.y - camera.y) * screen.h / camera.h,
+				SDL_max(box.w * screen.w / camera.w, 1), SDL_max(box.h * screen.h / camera.h, 1)};
+			SDL_RenderCopy(gRenderer, texture, NULL, &renderQuad);
+		}
+
+		//Frame
+		SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
+		SDL_RenderDrawRect(gRenderer, NULL);
+	}
+
+	//Back to the whole window
+	SDL_RenderSetViewport(gRenderer, NULL);
+}
+
 bool init()
 {
 	//Initialization flag
@@ -119,7 +381,9 @@ bool loadMedia()
 		success = false;
 	}
 	
-	//Nothing to load
+	//Build the world
+	gScene.generate(SCENE_OBJECTS);
+	
 	return success;
 }
 
@@ -140,6 +404,62 @@ void close()
 	SDL_Quit();
 }
 
+void setLayout(int players, bool minimap)
+{
+	gViewports.clear();
+
+	//Split the screen between the players
+	SDL_Rect screens[4];
+	int count = SDL_max(1, SDL_min(players, 4));
+	for(int i = 0; i < count; ++i)
+	{
+		SDL_Rect& screen = screens[i];
+		if(count == 1)
+		{
+			screen.x = 0;
+			screen.y = 0;
+			screen.w = SCREEN_WIDTH;
+			screen.h = SCREEN_HEIGHT;
+		}
+		else if(count == 2)
+		{
+			screen.x = i * SCREEN_WIDTH / 2;
+			screen.y = 0;
+			screen.w = SCREEN_WIDTH / 2;
+			screen.h = SCREEN_HEIGHT;
+		}
+		else if(count == 3 && i == 2)
+		{
+			//Bottom player gets the full width
+			screen.x = 0;
+			screen.y = SCREEN_HEIGHT / 2;
+			screen.w = SCREEN_WIDTH;
+			screen.h = SCREEN_HEIGHT / 2;
+		}
+		else
+		{
+			screen.x = (i % 2) * SCREEN_WIDTH / 2;
+			screen.y = (i / 2) * SCREEN_HEIGHT / 2;
+			screen.w = SCREEN_WIDTH / 2;
+			screen.h = SCREEN_HEIGHT / 2;
+		}
+
+		//Players see the world at full size
+		SDL_Rect camera = {0, 0, screen.w, screen.h};
+		gViewports.add(screen, camera);
+	}
+
+	//Picture in picture of the whole world
+	if(minimap)
+	{
+		SDL_Rect screen = {SCREEN_WIDTH - MINIMAP_SIZE - 8, 8, MINIMAP_SIZE, MINIMAP_SIZE};
+		SDL_Rect camera = {0, 0, WORLD_WIDTH, WORLD_HEIGHT};
+		gViewports.add(screen, camera);
+	}
+
+	gPlayers = count;
+}
+
 int wmain( int argc, char* args[] )
 {
 	//Start up SDL and create window
@@ -162,6 +482,10 @@ int wmain( int argc, char* args[] )
 			//Event handler
 			SDL_Event e;
 
+			//Start with three players like the fixed layout
+			bool minimap = false;
+			setLayout(3, minimap);
+
 			//While application is running
 			while( !quit )
 			{
@@ -173,37 +497,40 @@ int wmain( int argc, char* args[] )
 					{
 						quit = true;
 					}
+					else if( e.type == SDL_KEYDOWN )
+					{
+						//One to four players
+						if( e.key.keysym.sym >= SDLK_1 && e.key.keysym.sym <= SDLK_4 )
+						{
+							setLayout(e.key.keysym.sym - SDLK_0, minimap);
+						}
+						//Toggle the minimap
+						else if( e.key.keysym.sym == SDLK_m )
+						{
+							minimap = !minimap;
+							setLayout(gPlayers, minimap);
+						}
+					}
 				}
 				
+				//Players orbit the middle of the world evenly spaced
+				double time = SDL_GetTicks() / 4000.0;
+				for(int i = 0; i < gPlayers; ++i)
+				{
+					double angle = time + i * 2.0 * 3.14159265358979 / gPlayers;
+					gViewports.centerCamera(i, WORLD_WIDTH / 2 + (int)(CAMERA_ORBIT * cos(angle)),
+						WORLD_HEIGHT / 2 + (int)(CAMERA_ORBIT * sin(angle)));
+				}
+				
+				//Find what every viewport sees in one pass over the scene
+				gViewports.cull(gScene);
+				
 				//Clear screen
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 				SDL_RenderClear( gRenderer );
 
-				//Top left corner viewport
-				SDL_Rect topLeftViewport = {0, 0, SCREEN_WIDTH/2, SCREEN_HEIGHT/2};
-				SDL_RenderSetViewport(gRenderer, &topLeftViewport);
-				
-				//Render texture to screen
-				SDL_RenderCopy(gRenderer, gTexture, NULL, NULL);
-				
-				//Top right viewport
-				SDL_Rect topRightViewport = {SCREEN_WIDTH/2, 0, SCREEN_WIDTH/2,
-					SCREEN_HEIGHT/2};
-				SDL_RenderSetViewport(gRenderer, &topRightViewport);
-				
-				//Render texture to screen
-				SDL_RenderCopy(gRenderer, gTexture, NULL, NULL);
-				
-				//Bottom viewport
-                SDL_Rect bottomViewport;
-                bottomViewport.x = 0;
-                bottomViewport.y = SCREEN_HEIGHT / 2;
-                bottomViewport.w = SCREEN_WIDTH;
-                bottomViewport.h = SCREEN_HEIGHT / 2;
-                SDL_RenderSetViewport( gRenderer, &bottomViewport );
-                
-                //Render texture to screen
-                SDL_RenderCopy( gRenderer, gTexture, NULL, NULL );
+				//Render every viewport
+				gViewports.render(gScene, gTexture);
 				
 				//Update screen
 				SDL_RenderPresent(gRenderer);
@@ -1,16 +1,30 @@
 /*This source code copyrighted by Lazy Foo' Productions (2004-2015)
 and may not be redistributed without written permission.*/
 
-//Using SDL, SDL_image, standard IO, and strings
+//Using SDL, SDL_image, standard IO, strings, and vectors
 #include <SDL.h>
 #include <SDL_image.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
+#include <vector>
+
+//SSE2 is always there on x64 and on x86 builds with /arch:SSE2, the compiler default
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Cyan color key as 0xRRGGBB
+const Uint32 COLOR_KEY = 0x0000FFFF;
+
+//Largest side a cached image may claim before the cache is treated as damaged
+const int KEYED_CACHE_MAX_SIDE = 16384;
+
 //Texture wrapper class 
 class LTexture
 {
@@ -52,6 +66,18 @@ bool loadMedia();
 //Frees media and shuts down SDL
 void close();
 
+//Turns color keyed and fully transparent ARGB pixels into transparent black
+void convertColorKey(Uint32* pixels, int count, Uint32 key);
+
+//Reads the converted pixels cached for an image with the given hash, false if missing or out of date
+bool loadKeyedCache(std::string imagePath, Uint32 imageHash, std::vector<Uint32>& pixels, int& width, int& height);
+
+//Writes the converted pixels next to the image, tagged with its hash
+void saveKeyedCache(std::string imagePath, Uint32 imageHash, std::vector<Uint32>& pixels, int width, int height);
+
+//Hashes a file's contents, 0 if it can't be read
+Uint32 hashFile(std::string path);
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -84,35 +110,61 @@ bool LTexture::loadFromFile(std::string path)
 	//The final texture
 	SDL_Texture* newTexture = NULL;
 	
-	//Load image at specified path 
-	SDL_Surface* loadedSurface = IMG_Load(path.c_str());
-	if(loadedSurface == NULL)
+	//Reuse the converted pixels from an earlier run if the image has not changed
+	std::vector<Uint32> pixels;
+	int width = 0;
+	int height = 0;
+	Uint32 imageHash = hashFile(path);
+	if(!loadKeyedCache(path, imageHash, pixels, width, height))
 	{
-		printf("Unable to load iamge %s! SDL_image Error: %s\n", path.c_str(), 
-			IMG_GetError());
-	}
-	else
-	{
-		//Color key image
-		SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format,
-			0, 0xFF, 0xFF));
+		//Load image at specified path 
+		SDL_Surface* loadedSurface = IMG_Load(path.c_str());
+		if(loadedSurface == NULL)
+		{
+			printf("Unable to load iamge %s! SDL_image Error: %s\n", path.c_str(), 
+				IMG_GetError());
+			return false;
+		}
 		
-		//Create texture from surface pixels
-		newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-		if(newTexture == NULL)
+		//Get the pixels as 32 bit ARGB
+		SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+		SDL_FreeSurface(loadedSurface);
+		if(formattedSurface == NULL)
 		{
-			printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(),
-				SDL_GetError());
+			printf("Unable to convert image %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+			return false;
 		}
-		else
+		
+		//Pack the rows tightly
+		width = formattedSurface->w;
+		height = formattedSurface->h;
+		pixels.resize(width * height);
+		for(int y = 0; y < height; ++y)
 		{
-			//Get image dimensions
-			mWidth = loadedSurface->w;
-			mHeight = loadedSurface->h;
+			memcpy(&pixels[y * width], (Uint8*)formattedSurface->pixels + y * formattedSurface->pitch, width * sizeof(Uint32));
 		}
+		SDL_FreeSurface(formattedSurface);
 		
-		//Get rid of old loaded surface
-		SDL_FreeSurface(loadedSurface);
+		//Color key image once and keep the result
+		convertColorKey(&pixels[0], (int)pixels.size(), COLOR_KEY);
+		saveKeyedCache(path, imageHash, pixels, width, height);
+	}
+	
+	//Create texture straight from the converted pixels
+	newTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, width, height);
+	if(newTexture == NULL)
+	{
+		printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(),
+			SDL_GetError());
+	}
+	else
+	{
+		SDL_UpdateTexture(newTexture, NULL, &pixels[0], width * sizeof(Uint32));
+		SDL_SetTextureBlendMode(newTexture, SDL_BLENDMODE_BLEND);
+		
+		//Get image dimensions
+		mWidth = width;
+		mHeight = height;
 	}
 	
 	//Return success
@@ -149,6 +201,121 @@ int LTexture::getHeight()
 	return mHeight;
 }
 
+void convertColorKey(Uint32* pixels, int count, Uint32 key)
+{
+	int i = 0;
+	
+	#ifdef USE_SSE2
+	//Four pixels at a time
+	__m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	__m128i keyColor = _mm_set1_epi32(key);
+	__m128i zero = _mm_setzero_si128();
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128i pixel = _mm_loadu_si128((__m128i*)(pixels + i));
+		
+		//Keyed and fully transparent pixels become transparent black
+		__m128i keyed = _mm_cmpeq_epi32(_mm_and_si128(pixel, colorMask), keyColor);
+		__m128i clear = _mm_cmpeq_epi32(_mm_srli_epi32(pixel, 24), zero);
+		_mm_storeu_si128((__m128i*)(pixels + i), _mm_andnot_si128(_mm_or_si128(keyed, clear), pixel));
+	}
+	#endif
+	
+	//The rest one at a time
+	for(; i < count; ++i)
+	{
+		if((pixels[i] & 0x00FFFFFF) == key || (pixels[i] >> 24) == 0)
+		{
+			pixels[i] = 0;
+		}
+	}
+}
+
+bool loadKeyedCache(std::string imagePath, Uint32 imageHash, std::vector<Uint32>& pixels, int& width, int& height)
+{
+	//The source contents tell if the image changed since the cache was written
+	if(imageHash == 0)
+	{
+		return false;
+	}
+	
+	SDL_RWops* file = SDL_RWFromFile((imagePath + ".keyed").c_str(), "rb");
+	if(file == NULL)
+	{
+		return false;
+	}
+	
+	//Header is the source hash, dimensions and key the pixels were converted with
+	Uint32 sourceHash = 0;
+	Sint32 header[3] = {0, 0, 0};
+	bool success = SDL_RWread(file, &sourceHash, sizeof(Uint32), 1) == 1 && SDL_RWread(file, header, sizeof(Sint32), 3) == 3 &&
+		sourceHash == imageHash && (Uint32)header[2] == COLOR_KEY &&
+		header[0] > 0 && header[0] <= KEYED_CACHE_MAX_SIDE && header[1] > 0 && header[1] <= KEYED_CACHE_MAX_SIDE;
+	
+	//The pixels have to fill the rest of the file exactly
+	if(success)
+	{
+		Sint64 pixelBytes = (Sint64)header[0] * header[1] * sizeof(Uint32);
+		success = SDL_RWsize(file) == (Sint64)(sizeof(Uint32) + sizeof(header)) + pixelBytes;
+	}
+	if(success)
+	{
+		width = header[0];
+		height = header[1];
+		pixels.resize(width * height);
+		success = SDL_RWread(file, &pixels[0], sizeof(Uint32), pixels.size()) == pixels.size();
+	}
+	
+	SDL_RWclose(file);
+	return success;
+}
+
+void saveKeyedCache(std::string imagePath, Uint32 imageHash, std::vector<Uint32>& pixels, int width, int height)
+{
+	if(imageHash == 0)
+	{
+		return;
+	}
+	
+	SDL_RWops* file = SDL_RWFromFile((imagePath + ".keyed").c_str(), "wb");
+	if(file == NULL)
+	{
+		printf("Warning: Unable to cache %s! SDL Error: %s\n", imagePath.c_str(), SDL_GetError());
+		return;
+	}
+	
+	Sint32 header[3] = {width, height, (Sint32)COLOR_KEY};
+	SDL_RWwrite(file, &imageHash, sizeof(Uint32), 1);
+	SDL_RWwrite(file, header, sizeof(Sint32), 3);
+	SDL_RWwrite(file, &pixels[0], sizeof(Uint32), pixels.size());
+	SDL_RWclose(file);
+}
+
+Uint32 hashFile(std::string path)
+{
+	SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+	if(file == NULL)
+	{
+		return 0;
+	}
+	
+	//FNV-1a over every byte
+	Uint32 hash = 2166136261u;
+	Uint8 buffer[4096];
+	size_t read;
+	while((read = SDL_RWread(file, buffer, 1, sizeof(buffer))) > 0)
+	{
+		for(size_t i = 0; i < read; ++i)
+		{
+			hash = (hash ^ buffer[i]) * 16777619u;
+		}
+	}
+	SDL_RWclose(file);
+	
+	//Keep 0 for unreadable files
+	return hash != 0 ? hash : 1;
+}
+
 bool init()
 {
 	//Initialization flag
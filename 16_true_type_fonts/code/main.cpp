@@ -10,6 +10,9 @@
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Milliseconds to sleep when there is nothing new to present
+const int IDLE_DELAY = 10;
+
 //Texture wrapper class 
 class LTexture
 {
@@ -26,6 +29,12 @@ class LTexture
 		//Creates image from font string
 		bool loadFromRenderedText(std::string textureText, SDL_Color textColor);
 		
+		//Creates blank texture
+		bool createBlank(int width, int height, SDL_TextureAccess access = SDL_TEXTUREACCESS_TARGET);
+
+		//Set self as render target
+		void setAsRenderTarget();
+
 		//Deallocates texture
 		void free();
 		
@@ -55,6 +64,46 @@ class LTexture
 		int mHeight;
 };
 
+//Opaque static content cached in a render target and only recomposed when invalidated
+class LLayer
+{
+	public:
+		//Initializes variables
+		LLayer();
+
+		//Creates the layer target
+		bool create(int width, int height);
+
+		//Deallocates the target
+		void free();
+
+		//Marks the layer to be recomposed
+		void invalidate();
+
+		//Checks whether the layer needs recomposing
+		bool isDirty();
+
+		//Directs rendering into the layer cleared to white
+		void begin();
+
+		//Directs rendering back to the window and marks the layer clean
+		void end();
+
+		//Composites the layer at given point
+		void render(int x, int y);
+
+		//Gets layer dimensions
+		int getWidth();
+		int getHeight();
+
+	private:
+		//The cached content
+		LTexture mTarget;
+
+		//Whether the content is out of date
+		bool mDirty;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -76,6 +125,9 @@ TTF_Font *gFont = NULL;
 //Rendered texture
 LTexture gTextTexture;
 
+//Cached text layer
+LLayer gTextLayer;
+
 LTexture::LTexture()
 {
 	//Intiialize
@@ -170,6 +222,32 @@ bool LTexture::loadFromRenderedText(std::string textureText, SDL_Color textColor
 	return (mTexture != NULL);
 }
 
+bool LTexture::createBlank(int width, int height, SDL_TextureAccess access)
+{
+	//Get rid of pre-existing texture
+	free();
+
+	//Create uninitialized texture
+	mTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA8888, access, width, height);
+	if(mTexture == NULL)
+	{
+		printf("Unable to create blank texture! SDL Error: %s\n", SDL_GetError());
+	}
+	else
+	{
+		mWidth = width;
+		mHeight = height;
+	}
+
+	return mTexture != NULL;
+}
+
+void LTexture::setAsRenderTarget()
+{
+	//Make self render target
+	SDL_SetRenderTarget(gRenderer, mTexture);
+}
+
 void LTexture::free()
 {
 	//Free texture if it exists
@@ -227,6 +305,72 @@ void LTexture::setColor(Uint8 red, Uint8 green, Uint8 blue)
 	SDL_SetTextureColorMod(mTexture, red, green, blue);
 }
 
+LLayer::LLayer()
+{
+	//Nothing composed yet
+	mDirty = true;
+}
+
+bool LLayer::create(int width, int height)
+{
+	//Needs composing after any resize
+	mDirty = true;
+	if(!mTarget.createBlank(width, height, SDL_TEXTUREACCESS_TARGET))
+	{
+		return false;
+	}
+
+	//Opaque layers are copied straight over the screen
+	mTarget.setBlendMode(SDL_BLENDMODE_NONE);
+	return true;
+}
+
+void LLayer::free()
+{
+	mTarget.free();
+	mDirty = true;
+}
+
+void LLayer::invalidate()
+{
+	mDirty = true;
+}
+
+bool LLayer::isDirty()
+{
+	return mDirty;
+}
+
+void LLayer::begin()
+{
+	//Compose into the layer over a white background
+	mTarget.setAsRenderTarget();
+	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_RenderClear(gRenderer);
+}
+
+void LLayer::end()
+{
+	//Back to the window
+	SDL_SetRenderTarget(gRenderer, NULL);
+	mDirty = false;
+}
+
+void LLayer::render(int x, int y)
+{
+	mTarget.render(x, y);
+}
+
+int LLayer::getWidth()
+{
+	return mTarget.getWidth();
+}
+
+int LLayer::getHeight()
+{
+	return mTarget.getHeight();
+}
+
 bool init()
 {
 	//Initialization flag
@@ -250,7 +394,7 @@ bool init()
 		else
 		{
 			//Create renderer for window
-			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED  | SDL_RENDERER_PRESENTVSYNC);
+			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED  | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 			if(gRenderer == NULL)
 			{
 				printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
@@ -331,6 +475,13 @@ bool loadMedia()
 		}
 	}
 
+	//Create the text layer
+	if(!gTextLayer.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+	{
+		printf("Failed to create text layer!\n");
+		success = false;
+	}
+
 	return success;
 }
 
@@ -338,6 +489,7 @@ void close()
 {
 	//Free loaded images
 	gTextTexture.free();
+	gTextLayer.free();
 	
 	//Free global font
 	TTF_CloseFont(gFont);
@@ -382,6 +534,9 @@ int wmain( int argc, char* args[] )
 			
 			//Flip type
 			SDL_RendererFlip flipType = SDL_FLIP_NONE;
+
+			//Whether the screen needs presenting
+			bool present = true;
 			
 			//While application is running
 			while( !quit )
@@ -394,17 +549,48 @@ int wmain( int argc, char* args[] )
 					{
 						quit = true;
 					}
+					//Window contents were lost
+					else if(e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED)
+					{
+						present = true;
+					}
+					//The device was reset and every render target lost its contents
+					else if(e.type == SDL_RENDER_TARGETS_RESET)
+					{
+						gTextLayer.invalidate();
+						present = true;
+					}
+				}
+
+				//Compose the text once
+				if(gTextLayer.isDirty())
+				{
+					gTextLayer.begin();
+					gTextTexture.render((SCREEN_WIDTH - gTextTexture.getWidth())/2, 
+						(SCREEN_HEIGHT - gTextTexture.getHeight())/2);
+					gTextLayer.end();
+					present = true;
+				}
+
+				//Only present when something changed
+				if(present)
+				{
+					//Clear screen
+					SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+					SDL_RenderClear( gRenderer );
+					
+					//Render current frame
+					gTextLayer.render(0, 0);
+					
+					//Update screen
+					SDL_RenderPresent(gRenderer);
+					present = false;
+				}
+				else
+				{
+					//Idle without spinning
+					SDL_Delay(IDLE_DELAY);
 				}
-				//Clear screen
-				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
-				SDL_RenderClear( gRenderer );
-				
-				//Render current frame
-				gTextTexture.render((SCREEN_WIDTH - gTextTexture.getWidth())/2, 
-					(SCREEN_HEIGHT - gTextTexture.getHeight())/2);
-				
-				//Update screen
-				SDL_RenderPresent(gRenderer);
 			}
 		}
 	}
@@ -1,14 +1,67 @@
-//Using SDL, SDL_image, standard IO, and strings
+//Using SDL, SDL_image, SDL_ttf, standard IO, file status, strings, and string streams
 #include <SDL.h>
 #include <SDL_image.h>
+#include <SDL_ttf.h>
 #include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
 #include <string>
+#include <sstream>
+#include <vector>
 #include <cmath>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Loads timed by the startup benchmark
+const int BENCHMARK_LOADS = 50;
+
+//Widget tree font size and spacing
+const int UI_FONT_SIZE = 16;
+const int UI_PADDING = 8;
+const int UI_SPACING = 4;
+const int UI_TEXT_MARGIN = 4;
+const int UI_BUTTON_WIDTH = 96;
+
+//Rows scrolled per wheel step
+const int UI_WHEEL_ROWS = 3;
+
+//Items the demo list starts with
+const int UI_LIST_ITEMS = 2000;
+
+//Widget tree colors
+const SDL_Color UI_CLEAR_COLOR = {0x00, 0x00, 0x00, 0x00};
+const SDL_Color UI_BACKGROUND_COLOR = {0xD0, 0xD0, 0xD0, 0xFF};
+const SDL_Color UI_FIELD_COLOR = {0xFF, 0xFF, 0xFF, 0xFF};
+const SDL_Color UI_FOCUS_COLOR = {0xFF, 0xFF, 0xE0, 0xFF};
+const SDL_Color UI_HOVER_COLOR = {0xE0, 0xE8, 0xFF, 0xFF};
+const SDL_Color UI_SELECTED_COLOR = {0xA0, 0xC0, 0xFF, 0xFF};
+const SDL_Color UI_TEXT_COLOR = {0x00, 0x00, 0x00, 0xFF};
+
+//Cooked texture identifier, "LTEX" in file byte order
+const Uint32 COOKED_MAGIC = 0x5845544C;
+
+//Cooked container layout, bumped when the header changes
+const Uint32 COOKED_VERSION = 3;
+
+//Largest side a cooked texture may claim before the container is treated as damaged
+const int COOKED_MAX_SIDE = 16384;
+
+//Header the asset cooker writes before each mip level's tightly packed rows
+struct CookedHeader
+{
+	Uint32 magic;
+	Uint32 version;
+	Uint32 sourceSize;
+	Uint32 sourceTime;
+	Uint32 format;
+	Sint32 width;
+	Sint32 height;
+	Sint32 mipLevels;
+};
+
 enum LButtonSprite
 {
 	BUTTON_SPRITE_MOUSE_OUT = 0,
@@ -18,6 +71,16 @@ enum LButtonSprite
 	BUTTON_SPRITE_TOTAL = 4
 };
 
+enum LWidgetType
+{
+	WIDGET_BOX = 0,
+	WIDGET_LABEL = 1,
+	WIDGET_BUTTON = 2,
+	WIDGET_TEXT_FIELD = 3,
+	WIDGET_LIST = 4,
+	WIDGET_TOTAL = 5
+};
+
 //Texture wrapper class 
 class LTexture
 {
@@ -28,9 +91,15 @@ class LTexture
 		//Deallocates memory
 		~LTexture();
 		
-		//Loads image at specified path
+		//Loads image at specified path, using its cooked container if there is one
 		bool loadFromFile(std::string path);
 		
+		//Decodes and color keys the image itself
+		bool loadFromImage(std::string path);
+		
+		//Loads a texture container made by the asset cooker, rejecting it if the source image changed since
+		bool loadFromCooked(std::string path, std::string sourcePath);
+		
 		//if SDL_ttf.h is not included, the compiler will ignore this code
 		#ifdef _SDL_TTF_H
 		//Creates image from font string
@@ -53,6 +122,9 @@ class LTexture
 		void render(int x, int y, SDL_Rect* clip = NULL, double angle = 0.0,
 			SDL_Point* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE);
 		
+		//Renders the clip scaled to fill the destination
+		void renderStretched(SDL_Rect* clip, SDL_Rect* destination);
+		
 		//Gets image dimensions
 		int getWidth();
 		int getHeight();
@@ -76,8 +148,14 @@ class LButton
 		//Sets top left position
 		void setPosition(int x, int y);
 		
-		//Handles mouse event_callback
-		void handleEvent(SDL_Event* e);
+		//Sets clickable size, the sprite is scaled to fit
+		void setSize(int w, int h);
+		
+		//Gets the clickable area
+		SDL_Rect getRect();
+		
+		//Handles mouse event already hit tested against the button
+		void handleEvent(SDL_Event* e, bool inside);
 		
 		//Shows button sprite
 		void render();
@@ -87,10 +165,288 @@ class LButton
 		//Top left position
 		SDL_Point mPosition;
 		
+		//Clickable size
+		int mWidth;
+		int mHeight;
+		
 		//Currently used global sprite
 		LButtonSprite mCurrentSprite;
 };
 
+//Uniform grid over the button rects so a mouse event only tests the buttons under it
+class LButtonIndex
+{
+	public:
+		//Initializes internal variables
+		LButtonIndex();
+		
+		//Buckets every button into the cells its rect overlaps
+		void build(std::vector<LButton>* buttons, int width, int height, int cellSize);
+		
+		//Gets the topmost button containing the point, -1 if there is none
+		int hitTest(int x, int y);
+		
+		//Resolves the hovered button once and sends enter/leave to the buttons that changed
+		void handleEvent(SDL_Event* e);
+		
+		//Gets the hovered button, -1 if there is none
+		int getHovered();
+		
+		//Prints hit test counters
+		void printStats();
+		
+	private:
+		//Indexed buttons
+		std::vector<LButton>* mButtons;
+		
+		//Button indices per cell, in draw order
+		std::vector< std::vector<int> > mCells;
+		
+		//Grid dimensions
+		int mColumns;
+		int mRows;
+		int mCellSize;
+		
+		//Button under the mouse
+		int mHovered;
+		
+		//Events resolved, rects tested and time spent
+		Uint64 mEvents;
+		Uint64 mTests;
+		Uint64 mCounts;
+};
+
+class LWidget;
+
+//Called when a widget is clicked, selected or submitted
+typedef void (*LWidgetCallback)(LWidget* widget);
+
+//Consecutive solid rects sharing a color, drawn with one call, or consecutive textured quads
+struct LBatchRun
+{
+	bool textured;
+	SDL_Color color;
+	int first;
+	int count;
+};
+
+//Textured quad taken from part of a texture
+struct LTexturedQuad
+{
+	LTexture* texture;
+	SDL_Rect clip;
+	SDL_Rect destination;
+};
+
+//Quads the widget tree emits, kept until the tree changes
+class LQuadBatch
+{
+	public:
+		//Initializes internal variables
+		LQuadBatch();
+		
+		//Drops every quad
+		void clear();
+		
+		//Adds a solid rect, merged into the previous run if the color matches
+		void addFill(SDL_Rect rect, SDL_Color color);
+		
+		//Adds part of a texture stretched over the destination
+		void addQuad(LTexture* texture, SDL_Rect clip, SDL_Rect destination);
+		
+		//Draws the runs in emit order so later widgets cover earlier ones
+		void draw();
+		
+		//Gets batch sizes
+		int getFillCalls();
+		int getFillCount();
+		int getQuadCount();
+		
+	private:
+		//Solid rects and textured quads in emit order
+		std::vector<SDL_Rect> mFillRects;
+		std::vector<LTexturedQuad> mQuads;
+		
+		//Alternating fill and quad runs, a new one starting whenever the kind or fill color changes
+		std::vector<LBatchRun> mRuns;
+		
+		//Number of fill runs
+		int mFillCalls;
+};
+
+//Node of the retained widget tree
+class LWidget
+{
+	public:
+		//Initializes internal variables
+		LWidget(LWidgetType type);
+		
+		//Deletes the subtree
+		~LWidget();
+		
+		//Adds a child the widget then owns
+		LWidget* addChild(LWidget* child);
+		
+		//Stacks box children top to bottom instead of left to right
+		void setVertical(bool vertical);
+		
+		//Sets background color
+		void setColor(SDL_Color color);
+		
+		//Sets size along the parent box, 0 shares the space left over
+		void setPreferredSize(int w, int h);
+		
+		//Sets label, button or text field text
+		void setText(std::string text);
+		std::string getText();
+		
+		//Sets what clicks, selections and submits call
+		void setCallback(LWidgetCallback callback);
+		
+		//List items
+		void addItem(std::string item);
+		void removeItem(int index);
+		std::string getItem(int index);
+		int getItemCount();
+		int getSelected();
+		
+		//Marks this subtree for layout and its ancestors as leading to it
+		void invalidateLayout();
+		
+		//Asks for the quads to be emitted again without a layout
+		void invalidateVisual();
+		
+		//Returns and clears the tree's redraw request, called on the root
+		bool takeRedraw();
+		
+		//Lays out the subtree in the rect, skipping clean subtrees that keep their rect
+		//Returns the number of widgets arranged
+		int layout(SDL_Rect rect);
+		
+		//Gets the deepest widget under the point
+		LWidget* hitTest(int x, int y);
+		
+		//Handles mouse event already hit tested against the widget
+		void handleMouse(SDL_Event* e, bool inside);
+		
+		//Handles keys and text while focused
+		void handleKey(SDL_Event* e);
+		
+		//Keyboard focus
+		bool canFocus();
+		void setFocus(bool focused);
+		
+		//Emits the widget's quads and then its children's
+		void emit(LQuadBatch* batch);
+		
+	private:
+		//Places children inside the rect
+		int arrangeBox();
+		
+		//Sizes the visible row cache to the rect
+		int arrangeList();
+		
+		//Renders mText again
+		void renderText();
+		
+		//Emits the visible rows
+		void emitList(LQuadBatch* batch);
+		
+		//Gets the item at a screen row, -1 if there is none
+		int getItemAt(int y);
+		
+		//Gets the number of fully visible rows
+		int getVisibleRows();
+		
+		//What the widget is
+		LWidgetType mType;
+		
+		//Tree links
+		LWidget* mParent;
+		std::vector<LWidget*> mChildren;
+		
+		//Arranged area and requested size
+		SDL_Rect mRect;
+		int mPreferredWidth;
+		int mPreferredHeight;
+		
+		//This subtree needs layout, a descendant needs layout, the tree needs new quads
+		bool mLayoutDirty;
+		bool mChildDirty;
+		bool mRedraw;
+		
+		//Box direction and background
+		bool mVertical;
+		SDL_Color mColor;
+		
+		//Text and its cached rendering
+		std::string mText;
+		LTexture mTextTexture;
+		
+		//Button state
+		LButtonSprite mCurrentSprite;
+		
+		//Text field focus
+		bool mFocused;
+		
+		//List items, first visible item, selected and hovered item
+		std::vector<std::string> mItems;
+		int mFirstItem;
+		int mSelected;
+		int mHoveredItem;
+		
+		//Rendered rows, indexed by item modulo the visible rows, and the item each holds
+		std::vector<LTexture> mRowText;
+		std::vector<int> mRowItem;
+		
+		//Click, select or submit handler
+		LWidgetCallback mCallback;
+};
+
+//Routes events into a widget tree and redraws it only when it changed
+class LWidgetTree
+{
+	public:
+		//Initializes internal variables
+		LWidgetTree();
+		
+		//Takes ownership of the root and the area it fills
+		void setRoot(LWidget* root, SDL_Rect rect);
+		
+		//Resolves mouse events to one widget and key events to the focused one
+		void handleEvent(SDL_Event* e);
+		
+		//Lays out dirty subtrees, rebuilds the batch if anything changed and draws it
+		void render();
+		
+		//Deletes the tree
+		void free();
+		
+		//Prints layout and batch counters
+		void printStats();
+		
+	private:
+		//Tree and its area
+		LWidget* mRoot;
+		SDL_Rect mRect;
+		
+		//Widget under the mouse and widget taking keys
+		LWidget* mHovered;
+		LWidget* mFocused;
+		
+		//Cached quads
+		LQuadBatch mBatch;
+		
+		//Layout passes that did work, widgets they arranged and time they took
+		int mLayoutPasses;
+		int mArranged;
+		Uint64 mLayoutCounts;
+		
+		//Frames drawn and batches rebuilt
+		int mFrames;
+		int mBatchBuilds;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -100,6 +456,23 @@ bool loadMedia();
 //Frees media and shuts down SDL
 void close();
 
+//Times loading the button sheet from PNG against its cooked container
+void runLoadBenchmark();
+
+//Gets a file's size and modification time, false if it doesn't exist
+bool getFileStamp(std::string path, Uint32& size, Uint32& modified);
+
+//Lays out the four corner buttons or the dense panel and rebuilds the hit test grid
+void layoutButtons(bool panel);
+
+//Builds the widget tree shown with F1
+void buildInterface();
+
+//Widget tree callbacks, each works on the global widgets so the sender is unused
+void addListItem(LWidget* widget);
+void removeListItem(LWidget* widget);
+void selectListItem(LWidget* widget);
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -107,13 +480,30 @@ SDL_Window* gWindow = NULL;
 SDL_Renderer* gRenderer = NULL;
 
 //Globally used font
-//TTF_Font *gFont = NULL;
+TTF_Font *gFont = NULL;
 
 //Button constants
 const int BUTTON_WIDTH = 300;
 const int BUTTON_HEIGHT = 200;
 const int TOTAL_BUTTONS = 4;
-LButton gButtons[TOTAL_BUTTONS];
+
+//Dense panel of small buttons toggled with G
+const int PANEL_COLUMNS = 64;
+const int PANEL_ROWS = 48;
+
+//Side of a hit test grid cell
+const int HIT_CELL_SIZE = 32;
+
+//Buttons and the grid that hit tests them
+std::vector<LButton> gButtons;
+LButtonIndex gButtonIndex;
+
+//Widget tree and the widgets its callbacks use
+LWidgetTree gInterface;
+LWidget* gNameField = NULL;
+LWidget* gItemList = NULL;
+LWidget* gStatusLabel = NULL;
+LWidget* gCountLabel = NULL;
 
 //Global sprites
 LTexture gButtonSpriteSheetTexture;
@@ -134,6 +524,78 @@ LTexture::~LTexture()
 }
 
 bool LTexture::loadFromFile(std::string path)
+{
+	//Prefer the cooked container while it still matches the image
+	if(loadFromCooked(path + ".tex", path))
+	{
+		return true;
+	}
+	
+	return loadFromImage(path);
+}
+
+bool LTexture::loadFromCooked(std::string path, std::string sourcePath)
+{
+	//Get rid of pre-existing texture
+	free();
+	
+	SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+	if(file == NULL)
+	{
+		return false;
+	}
+	
+	//Read the whole container in one go
+	Sint64 fileSize = SDL_RWsize(file);
+	std::vector<Uint8> data(fileSize > 0 ? (size_t)fileSize : 0);
+	bool success = !data.empty() && SDL_RWread(file, &data[0], data.size(), 1) == 1;
+	SDL_RWclose(file);
+	
+	//Check the header before trusting the pixels, the cooker only writes ARGB8888
+	CookedHeader header;
+	if(success && data.size() >= sizeof(header))
+	{
+		memcpy(&header, &data[0], sizeof(header));
+		success = header.magic == COOKED_MAGIC && header.version == COOKED_VERSION && header.format == SDL_PIXELFORMAT_ARGB8888 &&
+			header.width > 0 && header.width <= COOKED_MAX_SIDE && header.height > 0 && header.height <= COOKED_MAX_SIDE && header.mipLevels >= 1 &&
+			(Sint64)data.size() >= (Sint64)sizeof(header) + (Sint64)header.width * header.height * (Sint64)sizeof(Uint32);
+	}
+	else
+	{
+		success = false;
+	}
+	if(!success)
+	{
+		printf("Cooked texture %s is invalid!\n", path.c_str());
+		return false;
+	}
+	
+	//An unreadable source leaves the container as the only copy
+	Uint32 sourceSize = 0;
+	Uint32 sourceTime = 0;
+	if(getFileStamp(sourcePath, sourceSize, sourceTime) && (header.sourceSize != sourceSize || header.sourceTime != sourceTime))
+	{
+		printf("Cooked texture %s is out of date, loading the image instead\n", path.c_str());
+		return false;
+	}
+	
+	//The base level goes straight to the texture
+	mTexture = SDL_CreateTexture(gRenderer, header.format, SDL_TEXTUREACCESS_STATIC, header.width, header.height);
+	if(mTexture == NULL)
+	{
+		printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+		return false;
+	}
+	SDL_UpdateTexture(mTexture, NULL, &data[sizeof(header)], header.width * sizeof(Uint32));
+	SDL_SetTextureBlendMode(mTexture, SDL_BLENDMODE_BLEND);
+	
+	//Get image dimensions
+	mWidth = header.width;
+	mHeight = header.height;
+	return true;
+}
+
+bool LTexture::loadFromImage(std::string path)
 {
 	//Get rid of pre-existing texture
 	free();
@@ -244,6 +706,12 @@ void LTexture::render(int x, int y, SDL_Rect* clip,
 	SDL_RenderCopyEx(gRenderer, mTexture, clip, &renderQuad, angle, center, flip);
 }
 
+void LTexture::renderStretched(SDL_Rect* clip, SDL_Rect* destination)
+{
+	//Let the renderer scale the clip
+	SDL_RenderCopy(gRenderer, mTexture, clip, destination);
+}
+
 int LTexture::getWidth()
 {
 	return mWidth;
@@ -276,6 +744,8 @@ LButton::LButton()
 {
 	mPosition.x = 0;
 	mPosition.y = 0;
+	mWidth = BUTTON_WIDTH;
+	mHeight = BUTTON_HEIGHT;
 	mCurrentSprite = BUTTON_SPRITE_MOUSE_OUT;
 }
 
@@ -285,177 +755,1107 @@ void LButton::setPosition(int x, int y)
 	mPosition.y = y;
 }
 
-void LButton::handleEvent(SDL_Event* e)
+void LButton::setSize(int w, int h)
 {
-	//If mouse event happened
-	if(e->type == SDL_MOUSEMOTION || e->type == SDL_MOUSEBUTTONDOWN 
-		|| e->type == SDL_MOUSEBUTTONUP)
-	{
-		//Get mouse position
-		int x, y;
-		SDL_GetMouseState(&x, &y);
-		
-		//Check if mouse is in button
-		bool inside = true;
-		
-		//Mouse is left of the button
-		if(x < mPosition.x)
-		{
-			inside = false;
-		}
-		//Mouse is right of the button
-		else if(x > mPosition.x + BUTTON_WIDTH)
-		{
-			inside = false;
-		}
-		//Mouse is above the button
-		else if(y < mPosition.y)
-		{
-			inside = false;
-		}
-		//Mouse is below the button 
-		else if(y > mPosition.y + BUTTON_HEIGHT)
-		{
-			inside = false;
-		}
-		
-		//Mouse is outside button
-		if(!inside)
-		{
-			mCurrentSprite = BUTTON_SPRITE_MOUSE_OUT;
-		}
-		//Mouse is inside button
-		else
-		{
-			//Set mouse over sprite
-			switch(e->type)
-			{
-				case SDL_MOUSEMOTION:
-					mCurrentSprite = BUTTON_SPRITE_MOUSE_OVER_MOTION;
-					break;
-					
-				case SDL_MOUSEBUTTONDOWN:
-					mCurrentSprite = BUTTON_SPRITE_MOUSE_DOWN;
-					break;
-					
-				case SDL_MOUSEBUTTONUP:
-					mCurrentSprite = BUTTON_SPRITE_MOUSE_UP;
-					break;
-			}
-		}
-	}
+	mWidth = w;
+	mHeight = h;
 }
 
-void LButton::render()
+SDL_Rect LButton::getRect()
 {
-	//Show current button sprite
-	gButtonSpriteSheetTexture.render(mPosition.x, mPosition.y,
-		&gSpriteClips[mCurrentSprite]);
+	SDL_Rect rect = {mPosition.x, mPosition.y, mWidth, mHeight};
+	return rect;
 }
 
-bool init()
+void LButton::handleEvent(SDL_Event* e, bool inside)
 {
-	//Initialization flag
-	bool success = true;
-
-	//Initialize SDL
-	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
+	//Mouse is outside button
+	if(!inside)
 	{
-		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
-		success = false;
+		mCurrentSprite = BUTTON_SPRITE_MOUSE_OUT;
 	}
+	//Mouse is inside button
 	else
 	{
-		//Create window
-		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
-		if(gWindow == NULL)
+		//Set mouse over sprite
+		switch(e->type)
 		{
-			printf( "Window could not be created! SDL Error: %s\n", SDL_GetError() );
-			success = false;
-		}
-		else
-		{
-			//Create renderer for window
-			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED  | SDL_RENDERER_PRESENTVSYNC);
-			if(gRenderer == NULL)
-			{
-				printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
-				success = false;
-			}
-			else
-			{
-				//Initialize renderer color
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+			case SDL_MOUSEMOTION:
+				mCurrentSprite = BUTTON_SPRITE_MOUSE_OVER_MOTION;
+				break;
 				
-				//Initialize PNG loading
-				int imgFlags = IMG_INIT_PNG;
-				if(!(IMG_Init(imgFlags) & imgFlags))
-				{
-					printf("SDL_image could not intialize! SDL image Error: %s\n", IMG_GetError());
-					success = false;
-				}
+			case SDL_MOUSEBUTTONDOWN:
+				mCurrentSprite = BUTTON_SPRITE_MOUSE_DOWN;
+				break;
 				
-				//Initialize SDL_ttf
-				//if(TTF_Init() == -1)
-				{
-					//printf("SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
-				}
-			}
+			case SDL_MOUSEBUTTONUP:
+				mCurrentSprite = BUTTON_SPRITE_MOUSE_UP;
+				break;
 		}
 	}
-
-	return success;
 }
 
-SDL_Texture* loadTexture(std::string path)
+void LButton::render()
 {
-	//The final texture
-	SDL_Texture* newTexture = NULL;
-	
-	//Load image at specified path
-	SDL_Surface* loadedSurface = IMG_Load(path.c_str());
-	if(loadedSurface == NULL)
+	//Show current button sprite
+	if(mWidth == BUTTON_WIDTH && mHeight == BUTTON_HEIGHT)
 	{
-		printf("Unable to load image %s! SDL image Error: %s\n", path.c_str(),IMG_GetError());
+		gButtonSpriteSheetTexture.render(mPosition.x, mPosition.y,
+			&gSpriteClips[mCurrentSprite]);
 	}
+	//Scale the sprite down to the button
 	else
 	{
-		//Create texture from surface pixels 
-		newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-		if(newTexture == NULL)
-		{
-			printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
-		}
-		
-		//Get rid of old loaded surface
-		SDL_FreeSurface(loadedSurface);
+		SDL_Rect destination = getRect();
+		gButtonSpriteSheetTexture.renderStretched(&gSpriteClips[mCurrentSprite], &destination);
 	}
-	
-	return newTexture;
 }
 
-bool loadMedia()
+LButtonIndex::LButtonIndex()
 {
-	//Loading success flag
-	bool success = true;
+	mButtons = NULL;
+	mColumns = 0;
+	mRows = 0;
+	mCellSize = 1;
+	mHovered = -1;
+	mEvents = 0;
+	mTests = 0;
+	mCounts = 0;
+}
+
+void LButtonIndex::build(std::vector<LButton>* buttons, int width, int height, int cellSize)
+{
+	mButtons = buttons;
+	mCellSize = cellSize;
+	mColumns = (width + cellSize - 1) / cellSize;
+	mRows = (height + cellSize - 1) / cellSize;
+	mHovered = -1;
 	
-	//Open the font
-	/*gFont = TTF_OpenFont("lazy.ttf", 28);
-	if(gFont == NULL)
+	//Start from empty cells
+	mCells.clear();
+	mCells.resize(mColumns * mRows);
+	
+	//Buttons are added in draw order so the last match in a cell is on top
+	for(int i = 0; i < (int)buttons->size(); ++i)
+	{
+		SDL_Rect rect = (*buttons)[i].getRect();
+		if(rect.w <= 0 || rect.h <= 0 || rect.x + rect.w <= 0 || rect.y + rect.h <= 0)
+		{
+			continue;
+		}
+		
+		//Cells the rect overlaps, clipped to the grid
+		int left = SDL_max(rect.x / cellSize, 0);
+		int top = SDL_max(rect.y / cellSize, 0);
+		int right = SDL_min((rect.x + rect.w - 1) / cellSize, mColumns - 1);
+		int bottom = SDL_min((rect.y + rect.h - 1) / cellSize, mRows - 1);
+		for(int y = top; y <= bottom; ++y)
+		{
+			for(int x = left; x <= right; ++x)
+			{
+				mCells[y * mColumns + x].push_back(i);
+			}
+		}
+	}
+}
+
+int LButtonIndex::hitTest(int x, int y)
+{
+	//Nothing outside the grid
+	if(mButtons == NULL || x < 0 || y < 0 || x >= mColumns * mCellSize || y >= mRows * mCellSize)
+	{
+		return -1;
+	}
+	
+	//Only the buttons sharing the point's cell can contain it
+	std::vector<int>& cell = mCells[(y / mCellSize) * mColumns + x / mCellSize];
+	for(int i = (int)cell.size() - 1; i >= 0; --i)
+	{
+		++mTests;
+		SDL_Rect rect = (*mButtons)[cell[i]].getRect();
+		if(x >= rect.x && x < rect.x + rect.w && y >= rect.y && y < rect.y + rect.h)
+		{
+			return cell[i];
+		}
+	}
+	
+	return -1;
+}
+
+void LButtonIndex::handleEvent(SDL_Event* e)
+{
+	//Take the position from the event instead of querying the mouse
+	int x, y;
+	if(e->type == SDL_MOUSEMOTION)
+	{
+		x = e->motion.x;
+		y = e->motion.y;
+	}
+	else if(e->type == SDL_MOUSEBUTTONDOWN || e->type == SDL_MOUSEBUTTONUP)
+	{
+		x = e->button.x;
+		y = e->button.y;
+	}
+	//Mouse left the window so nothing is hovered
+	else if(e->type == SDL_WINDOWEVENT && e->window.event == SDL_WINDOWEVENT_LEAVE)
+	{
+		x = -1;
+		y = -1;
+	}
+	else
+	{
+		return;
+	}
+	
+	Uint64 start = SDL_GetPerformanceCounter();
+	int hit = hitTest(x, y);
+	
+	//Leave the previously hovered button
+	if(hit != mHovered)
+	{
+		if(mHovered != -1)
+		{
+			(*mButtons)[mHovered].handleEvent(e, false);
+		}
+		mHovered = hit;
+	}
+	
+	//Enter or update the hovered one
+	if(hit != -1)
+	{
+		(*mButtons)[hit].handleEvent(e, true);
+	}
+	
+	mCounts += SDL_GetPerformanceCounter() - start;
+	++mEvents;
+}
+
+int LButtonIndex::getHovered()
+{
+	return mHovered;
+}
+
+void LButtonIndex::printStats()
+{
+	if(mEvents == 0)
+	{
+		return;
+	}
+	
+	printf("Hit test: %d events, %.2f rects tested per event, %.3f us per event\n", (int)mEvents,
+		(double)mTests / mEvents, 1000000.0 * mCounts / SDL_GetPerformanceFrequency() / mEvents);
+}
+
+LQuadBatch::LQuadBatch()
+{
+	mFillCalls = 0;
+}
+
+void LQuadBatch::clear()
+{
+	mFillRects.clear();
+	mQuads.clear();
+	mRuns.clear();
+	mFillCalls = 0;
+}
+
+void LQuadBatch::addFill(SDL_Rect rect, SDL_Color color)
+{
+	//Extend the last run when it is a fill of the same color
+	if(!mRuns.empty())
+	{
+		LBatchRun& run = mRuns.back();
+		if(!run.textured && run.color.r == color.r && run.color.g == color.g && run.color.b == color.b && run.color.a == color.a)
+		{
+			mFillRects.push_back(rect);
+			++run.count;
+			return;
+		}
+	}
+	
+	LBatchRun run = {false, color, (int)mFillRects.size(), 1};
+	mRuns.push_back(run);
+	mFillRects.push_back(rect);
+	++mFillCalls;
+}
+
+void LQuadBatch::addQuad(LTexture* texture, SDL_Rect clip, SDL_Rect destination)
+{
+	LTexturedQuad quad = {texture, clip, destination};
+	
+	//Extend the last run when it is textured too
+	if(!mRuns.empty() && mRuns.back().textured)
+	{
+		mQuads.push_back(quad);
+		++mRuns.back().count;
+		return;
+	}
+	
+	LBatchRun run = {true, UI_CLEAR_COLOR, (int)mQuads.size(), 1};
+	mRuns.push_back(run);
+	mQuads.push_back(quad);
+}
+
+void LQuadBatch::draw()
+{
+	for(int i = 0; i < (int)mRuns.size(); ++i)
+	{
+		LBatchRun& run = mRuns[i];
+		if(run.textured)
+		{
+			//Sprites and text cover whatever came before them
+			for(int j = run.first; j < run.first + run.count; ++j)
+			{
+				LTexturedQuad& quad = mQuads[j];
+				quad.texture->renderStretched(&quad.clip, &quad.destination);
+			}
+		}
+		else
+		{
+			//One call per run of same colored rects
+			SDL_SetRenderDrawColor(gRenderer, run.color.r, run.color.g, run.color.b, run.color.a);
+			SDL_RenderFillRects(gRenderer, &mFillRects[run.first], run.count);
+		}
+	}
+}
+
+int LQuadBatch::getFillCalls()
+{
+	return mFillCalls;
+}
+
+int LQuadBatch::getFillCount()
+{
+	return (int)mFillRects.size();
+}
+
+int LQuadBatch::getQuadCount()
+{
+	return (int)mQuads.size();
+}
+
+LWidget::LWidget(LWidgetType type)
+{
+	mType = type;
+	mParent = NULL;
+	mRect.x = 0;
+	mRect.y = 0;
+	mRect.w = 0;
+	mRect.h = 0;
+	mPreferredWidth = 0;
+	mPreferredHeight = 0;
+	mLayoutDirty = true;
+	mChildDirty = false;
+	mRedraw = true;
+	mVertical = true;
+	mColor = UI_CLEAR_COLOR;
+	mCurrentSprite = BUTTON_SPRITE_MOUSE_OUT;
+	mFocused = false;
+	mFirstItem = 0;
+	mSelected = -1;
+	mHoveredItem = -1;
+	mCallback = NULL;
+	
+	//Everything but boxes and lists is one line of text tall
+	if(type != WIDGET_BOX && type != WIDGET_LIST)
+	{
+		mPreferredHeight = TTF_FontHeight(gFont) + 2 * UI_TEXT_MARGIN;
+	}
+	
+	//Text fields and lists draw their own background
+	if(type == WIDGET_TEXT_FIELD || type == WIDGET_LIST)
+	{
+		mColor = UI_FIELD_COLOR;
+	}
+}
+
+LWidget::~LWidget()
+{
+	for(int i = 0; i < (int)mChildren.size(); ++i)
+	{
+		delete mChildren[i];
+	}
+}
+
+LWidget* LWidget::addChild(LWidget* child)
+{
+	child->mParent = this;
+	mChildren.push_back(child);
+	
+	//The new child has to be placed
+	invalidateLayout();
+	return child;
+}
+
+void LWidget::setVertical(bool vertical)
+{
+	mVertical = vertical;
+	invalidateLayout();
+}
+
+void LWidget::setColor(SDL_Color color)
+{
+	mColor = color;
+	invalidateVisual();
+}
+
+void LWidget::setPreferredSize(int w, int h)
+{
+	if(w == mPreferredWidth && h == mPreferredHeight)
+	{
+		return;
+	}
+	
+	mPreferredWidth = w;
+	mPreferredHeight = h;
+	
+	//The parent sizes its children so it lays out again, siblings that keep their rect are skipped
+	if(mParent != NULL)
+	{
+		mParent->invalidateLayout();
+	}
+	else
+	{
+		invalidateLayout();
+	}
+}
+
+void LWidget::setText(std::string text)
+{
+	if(text == mText)
+	{
+		return;
+	}
+	
+	mText = text;
+	renderText();
+	invalidateVisual();
+	
+	//Labels are as wide as their text
+	if(mType == WIDGET_LABEL)
+	{
+		setPreferredSize(mTextTexture.getWidth() + 2 * UI_TEXT_MARGIN, mPreferredHeight);
+	}
+}
+
+std::string LWidget::getText()
+{
+	return mText;
+}
+
+void LWidget::setCallback(LWidgetCallback callback)
+{
+	mCallback = callback;
+}
+
+void LWidget::addItem(std::string item)
+{
+	//Rows are laid out virtually so a new item only needs drawing
+	mItems.push_back(item);
+	invalidateVisual();
+}
+
+void LWidget::removeItem(int index)
+{
+	if(index < 0 || index >= (int)mItems.size())
+	{
+		return;
+	}
+	
+	mItems.erase(mItems.begin() + index);
+	
+	//Items after it moved up a row
+	if(mSelected == index)
+	{
+		mSelected = -1;
+	}
+	else if(mSelected > index)
+	{
+		--mSelected;
+	}
+	mFirstItem = SDL_max(SDL_min(mFirstItem, (int)mItems.size() - getVisibleRows()), 0);
+	for(int i = 0; i < (int)mRowItem.size(); ++i)
+	{
+		mRowItem[i] = -1;
+	}
+	invalidateVisual();
+}
+
+std::string LWidget::getItem(int index)
+{
+	if(index < 0 || index >= (int)mItems.size())
+	{
+		return "";
+	}
+	
+	return mItems[index];
+}
+
+int LWidget::getItemCount()
+{
+	return (int)mItems.size();
+}
+
+int LWidget::getSelected()
+{
+	return mSelected;
+}
+
+void LWidget::invalidateLayout()
+{
+	mLayoutDirty = true;
+	
+	//Ancestors already marked already lead here
+	for(LWidget* ancestor = mParent; ancestor != NULL && !ancestor->mChildDirty; ancestor = ancestor->mParent)
+	{
+		ancestor->mChildDirty = true;
+	}
+}
+
+void LWidget::invalidateVisual()
+{
+	//The request lives on the root
+	LWidget* root = this;
+	while(root->mParent != NULL)
+	{
+		root = root->mParent;
+	}
+	root->mRedraw = true;
+}
+
+bool LWidget::takeRedraw()
+{
+	bool redraw = mRedraw;
+	mRedraw = false;
+	return redraw;
+}
+
+int LWidget::layout(SDL_Rect rect)
+{
+	//A moved or resized widget has to place everything inside it again
+	if(rect.x != mRect.x || rect.y != mRect.y || rect.w != mRect.w || rect.h != mRect.h)
+	{
+		mRect = rect;
+		mLayoutDirty = true;
+	}
+	
+	int arranged = 0;
+	if(mLayoutDirty)
+	{
+		mLayoutDirty = false;
+		mChildDirty = false;
+		arranged = 1 + (mType == WIDGET_LIST ? arrangeList() : arrangeBox());
+		invalidateVisual();
+	}
+	//Only walk down to the dirty descendants, they keep their rects
+	else if(mChildDirty)
+	{
+		mChildDirty = false;
+		for(int i = 0; i < (int)mChildren.size(); ++i)
+		{
+			arranged += mChildren[i]->layout(mChildren[i]->mRect);
+		}
+	}
+	
+	return arranged;
+}
+
+int LWidget::arrangeBox()
+{
+	if(mChildren.empty())
+	{
+		return 0;
+	}
+	
+	//Area inside the padding
+	SDL_Rect inner = {mRect.x + UI_PADDING, mRect.y + UI_PADDING,
+		SDL_max(mRect.w - 2 * UI_PADDING, 0), SDL_max(mRect.h - 2 * UI_PADDING, 0)};
+	int available = mVertical ? inner.h : inner.w;
+	
+	//Preferred sizes come first, the rest is shared
+	int used = UI_SPACING * ((int)mChildren.size() - 1);
+	int flexible = 0;
+	for(int i = 0; i < (int)mChildren.size(); ++i)
+	{
+		int size = mVertical ? mChildren[i]->mPreferredHeight : mChildren[i]->mPreferredWidth;
+		if(size > 0)
+		{
+			used += size;
+		}
+		else
+		{
+			++flexible;
+		}
+	}
+	int share = flexible > 0 ? SDL_max(available - used, 0) / flexible : 0;
+	
+	//Stack the children
+	int arranged = 0;
+	int offset = mVertical ? inner.y : inner.x;
+	for(int i = 0; i < (int)mChildren.size(); ++i)
+	{
+		LWidget* child = mChildren[i];
+		int size = mVertical ? child->mPreferredHeight : child->mPreferredWidth;
+		if(size <= 0)
+		{
+			size = share;
+		}
+		
+		SDL_Rect rect = inner;
+		if(mVertical)
+		{
+			rect.y = offset;
+			rect.h = size;
+		}
+		else
+		{
+			rect.x = offset;
+			rect.w = size;
+		}
+		arranged += child->layout(rect);
+		offset += size + UI_SPACING;
+	}
+	
+	return arranged;
+}
+
+int LWidget::arrangeList()
+{
+	//Rows are rendered again the first time they show
+	int rows = getVisibleRows();
+	mRowText.clear();
+	mRowText.resize(rows);
+	mRowItem.assign(rows, -1);
+	mFirstItem = SDL_max(SDL_min(mFirstItem, (int)mItems.size() - rows), 0);
+	return 0;
+}
+
+int LWidget::getVisibleRows()
+{
+	return SDL_max(mRect.h / (TTF_FontHeight(gFont) + UI_TEXT_MARGIN), 0);
+}
+
+int LWidget::getItemAt(int y)
+{
+	int item = mFirstItem + (y - mRect.y) / (TTF_FontHeight(gFont) + UI_TEXT_MARGIN);
+	if(y < mRect.y || item >= (int)mItems.size() || item >= mFirstItem + getVisibleRows())
+	{
+		return -1;
+	}
+	
+	return item;
+}
+
+void LWidget::renderText()
+{
+	//Empty text renders to nothing
+	if(mText.empty())
+	{
+		mTextTexture.free();
+	}
+	else
+	{
+		mTextTexture.loadFromRenderedText(mText, UI_TEXT_COLOR);
+	}
+}
+
+LWidget* LWidget::hitTest(int x, int y)
+{
+	if(x < mRect.x || y < mRect.y || x >= mRect.x + mRect.w || y >= mRect.y + mRect.h)
+	{
+		return NULL;
+	}
+	
+	//Later children are drawn on top
+	for(int i = (int)mChildren.size() - 1; i >= 0; --i)
+	{
+		LWidget* hit = mChildren[i]->hitTest(x, y);
+		if(hit != NULL)
+		{
+			return hit;
+		}
+	}
+	
+	return this;
+}
+
+void LWidget::handleMouse(SDL_Event* e, bool inside)
+{
+	switch(mType)
+	{
+		case WIDGET_BUTTON:
+		{
+			//Same sprite states as LButton
+			LButtonSprite sprite = BUTTON_SPRITE_MOUSE_OUT;
+			if(inside)
+			{
+				switch(e->type)
+				{
+					case SDL_MOUSEMOTION:
+						sprite = mCurrentSprite == BUTTON_SPRITE_MOUSE_DOWN ? BUTTON_SPRITE_MOUSE_DOWN : BUTTON_SPRITE_MOUSE_OVER_MOTION;
+						break;
+						
+					case SDL_MOUSEBUTTONDOWN:
+						sprite = BUTTON_SPRITE_MOUSE_DOWN;
+						break;
+						
+					case SDL_MOUSEBUTTONUP:
+						sprite = BUTTON_SPRITE_MOUSE_UP;
+						
+						//Click when released over the button it was pressed on
+						if(mCurrentSprite == BUTTON_SPRITE_MOUSE_DOWN && mCallback != NULL)
+						{
+							mCallback(this);
+						}
+						break;
+						
+					default:
+						sprite = mCurrentSprite;
+						break;
+				}
+			}
+			
+			if(sprite != mCurrentSprite)
+			{
+				mCurrentSprite = sprite;
+				invalidateVisual();
+			}
+			break;
+		}
+			
+		case WIDGET_LIST:
+		{
+			int hovered = -1;
+			if(inside)
+			{
+				//Scroll by rows, nothing moves so no layout is needed
+				if(e->type == SDL_MOUSEWHEEL)
+				{
+					int first = SDL_max(SDL_min(mFirstItem - e->wheel.y * UI_WHEEL_ROWS, (int)mItems.size() - getVisibleRows()), 0);
+					if(first != mFirstItem)
+					{
+						mFirstItem = first;
+						invalidateVisual();
+					}
+					hovered = mHoveredItem;
+				}
+				else
+				{
+					int y = e->type == SDL_MOUSEMOTION ? e->motion.y : e->button.y;
+					hovered = getItemAt(y);
+					
+					//Select on press
+					if(e->type == SDL_MOUSEBUTTONDOWN && hovered != -1 && hovered != mSelected)
+					{
+						mSelected = hovered;
+						invalidateVisual();
+						if(mCallback != NULL)
+						{
+							mCallback(this);
+						}
+					}
+				}
+			}
+			
+			if(hovered != mHoveredItem)
+			{
+				mHoveredItem = hovered;
+				invalidateVisual();
+			}
+			break;
+		}
+			
+		default:
+			break;
+	}
+}
+
+void LWidget::handleKey(SDL_Event* e)
+{
+	if(mType != WIDGET_TEXT_FIELD)
+	{
+		return;
+	}
+	
+	//Append character
+	if(e->type == SDL_TEXTINPUT)
+	{
+		setText(mText + e->text.text);
+	}
+	else if(e->type == SDL_KEYDOWN)
+	{
+		//Lop off character
+		if(e->key.keysym.sym == SDLK_BACKSPACE && mText.length() > 0)
+		{
+			std::string text = mText;
+			text.pop_back();
+			setText(text);
+		}
+		//Submit
+		else if(e->key.keysym.sym == SDLK_RETURN && mCallback != NULL)
+		{
+			mCallback(this);
+		}
+	}
+}
+
+bool LWidget::canFocus()
+{
+	return mType == WIDGET_TEXT_FIELD;
+}
+
+void LWidget::setFocus(bool focused)
+{
+	mFocused = focused;
+	invalidateVisual();
+}
+
+void LWidget::emit(LQuadBatch* batch)
+{
+	if(mRect.w <= 0 || mRect.h <= 0)
+	{
+		return;
+	}
+	
+	//Background
+	if(mColor.a > 0)
+	{
+		batch->addFill(mRect, mType == WIDGET_TEXT_FIELD && mFocused ? UI_FOCUS_COLOR : mColor);
+	}
+	
+	//Button sprite scaled to the widget
+	if(mType == WIDGET_BUTTON)
+	{
+		batch->addQuad(&gButtonSpriteSheetTexture, gSpriteClips[mCurrentSprite], mRect);
+	}
+	
+	//Text, centered on buttons and left aligned elsewhere
+	if(mType == WIDGET_LIST)
+	{
+		emitList(batch);
+	}
+	else if(mTextTexture.getWidth() > 0)
+	{
+		int available = mRect.w - 2 * UI_TEXT_MARGIN;
+		int w = SDL_min(mTextTexture.getWidth(), available);
+		int h = SDL_min(mTextTexture.getHeight(), mRect.h);
+		
+		//Text fields keep the end of the text in view
+		SDL_Rect clip = {mType == WIDGET_TEXT_FIELD ? mTextTexture.getWidth() - w : 0, 0, w, h};
+		SDL_Rect destination = {mRect.x + UI_TEXT_MARGIN, mRect.y + (mRect.h - h) / 2, w, h};
+		if(mType == WIDGET_BUTTON)
+		{
+			destination.x = mRect.x + (mRect.w - w) / 2;
+		}
+		if(w > 0)
+		{
+			batch->addQuad(&mTextTexture, clip, destination);
+		}
+	}
+	
+	//Caret after the text
+	if(mType == WIDGET_TEXT_FIELD && mFocused)
+	{
+		SDL_Rect caret = {mRect.x + UI_TEXT_MARGIN + SDL_min(mTextTexture.getWidth(), mRect.w - 2 * UI_TEXT_MARGIN),
+			mRect.y + UI_TEXT_MARGIN, 2, mRect.h - 2 * UI_TEXT_MARGIN};
+		batch->addFill(caret, UI_TEXT_COLOR);
+	}
+	
+	for(int i = 0; i < (int)mChildren.size(); ++i)
+	{
+		mChildren[i]->emit(batch);
+	}
+}
+
+void LWidget::emitList(LQuadBatch* batch)
+{
+	int rows = (int)mRowText.size();
+	int rowHeight = TTF_FontHeight(gFont) + UI_TEXT_MARGIN;
+	for(int row = 0; row < rows; ++row)
+	{
+		int item = mFirstItem + row;
+		if(item >= (int)mItems.size())
+		{
+			break;
+		}
+		
+		//Highlight the selected and hovered rows
+		SDL_Rect rect = {mRect.x, mRect.y + row * rowHeight, mRect.w, rowHeight};
+		if(item == mSelected)
+		{
+			batch->addFill(rect, UI_SELECTED_COLOR);
+		}
+		else if(item == mHoveredItem)
+		{
+			batch->addFill(rect, UI_HOVER_COLOR);
+		}
+		
+		//Scrolling by a row only renders the row that came into view
+		int slot = item % rows;
+		if(mRowItem[slot] != item)
+		{
+			mRowText[slot].loadFromRenderedText(mItems[item], UI_TEXT_COLOR);
+			mRowItem[slot] = item;
+		}
+		
+		int w = SDL_min(mRowText[slot].getWidth(), mRect.w - 2 * UI_TEXT_MARGIN);
+		if(w > 0)
+		{
+			SDL_Rect clip = {0, 0, w, mRowText[slot].getHeight()};
+			SDL_Rect destination = {rect.x + UI_TEXT_MARGIN, rect.y + UI_TEXT_MARGIN / 2, w, clip.h};
+			batch->addQuad(&mRowText[slot], clip, destination);
+		}
+	}
+}
+
+LWidgetTree::LWidgetTree()
+{
+	mRoot = NULL;
+	mHovered = NULL;
+	mFocused = NULL;
+	mLayoutPasses = 0;
+	mArranged = 0;
+	mLayoutCounts = 0;
+	mFrames = 0;
+	mBatchBuilds = 0;
+}
+
+void LWidgetTree::setRoot(LWidget* root, SDL_Rect rect)
+{
+	free();
+	mRoot = root;
+	mRect = rect;
+}
+
+void LWidgetTree::handleEvent(SDL_Event* e)
+{
+	if(mRoot == NULL)
+	{
+		return;
+	}
+	
+	//Keys go to the focused widget
+	if(e->type == SDL_TEXTINPUT || e->type == SDL_KEYDOWN)
+	{
+		if(mFocused != NULL)
+		{
+			mFocused->handleKey(e);
+		}
+		return;
+	}
+	
+	//The wheel scrolls whatever is under the mouse
+	if(e->type == SDL_MOUSEWHEEL)
+	{
+		if(mHovered != NULL)
+		{
+			mHovered->handleMouse(e, true);
+		}
+		return;
+	}
+	
+	//Take the position from the event
+	int x, y;
+	if(e->type == SDL_MOUSEMOTION)
+	{
+		x = e->motion.x;
+		y = e->motion.y;
+	}
+	else if(e->type == SDL_MOUSEBUTTONDOWN || e->type == SDL_MOUSEBUTTONUP)
+	{
+		x = e->button.x;
+		y = e->button.y;
+	}
+	else if(e->type == SDL_WINDOWEVENT && e->window.event == SDL_WINDOWEVENT_LEAVE)
+	{
+		x = -1;
+		y = -1;
+	}
+	else
+	{
+		return;
+	}
+	
+	//Leave the previously hovered widget
+	LWidget* hit = mRoot->hitTest(x, y);
+	if(hit != mHovered)
+	{
+		if(mHovered != NULL)
+		{
+			mHovered->handleMouse(e, false);
+		}
+		mHovered = hit;
+	}
+	
+	//Presses move the focus
+	if(e->type == SDL_MOUSEBUTTONDOWN)
+	{
+		LWidget* focus = hit != NULL && hit->canFocus() ? hit : NULL;
+		if(focus != mFocused)
+		{
+			if(mFocused != NULL)
+			{
+				mFocused->setFocus(false);
+			}
+			mFocused = focus;
+			if(mFocused != NULL)
+			{
+				mFocused->setFocus(true);
+			}
+		}
+	}
+	
+	if(hit != NULL)
+	{
+		hit->handleMouse(e, true);
+	}
+}
+
+void LWidgetTree::render()
+{
+	if(mRoot == NULL)
+	{
+		return;
+	}
+	
+	//Clean trees return straight away
+	Uint64 start = SDL_GetPerformanceCounter();
+	int arranged = mRoot->layout(mRect);
+	if(arranged > 0)
+	{
+		mLayoutCounts += SDL_GetPerformanceCounter() - start;
+		mArranged += arranged;
+		++mLayoutPasses;
+	}
+	
+	//Emit again only when something changed
+	if(mRoot->takeRedraw())
+	{
+		mBatch.clear();
+		mRoot->emit(&mBatch);
+		++mBatchBuilds;
+	}
+	
+	mBatch.draw();
+	++mFrames;
+}
+
+void LWidgetTree::free()
+{
+	delete mRoot;
+	mRoot = NULL;
+	mHovered = NULL;
+	mFocused = NULL;
+	mBatch.clear();
+}
+
+void LWidgetTree::printStats()
+{
+	if(mLayoutPasses > 0)
+	{
+		printf("Widget layout: %d passes, %.1f widgets arranged per pass, %.3f us per pass\n", mLayoutPasses,
+			(double)mArranged / mLayoutPasses, 1000000.0 * mLayoutCounts / SDL_GetPerformanceFrequency() / mLayoutPasses);
+	}
+	if(mFrames > 0)
+	{
+		printf("Widget batch: %d of %d frames emitted quads, last batch %d fill calls for %d rects and %d textured quads\n",
+			mBatchBuilds, mFrames, mBatch.getFillCalls(), mBatch.getFillCount(), mBatch.getQuadCount());
+	}
+}
+
+bool init()
+{
+	//Initialization flag
+	bool success = true;
+
+	//Initialize SDL
+	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
 	{
-		printf("Failed to load lazy font! SDL_ttf Error:%s\n", TTF_GetError());
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
 		success = false;
 	}
 	else
 	{
-		//Render text
-		SDL_Color textColor = {0,0,0};
-		if(!gTextTexture.loadFromRenderedText("The quick brown fox jumps over the cow", textColor))
+		//Create window
+		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
+		if(gWindow == NULL)
 		{
-			printf("Failed to render text texture\n");
+			printf( "Window could not be created! SDL Error: %s\n", SDL_GetError() );
 			success = false;
 		}
-	}*/
+		else
+		{
+			//Create renderer for window
+			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED  | SDL_RENDERER_PRESENTVSYNC);
+			if(gRenderer == NULL)
+			{
+				printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
+				success = false;
+			}
+			else
+			{
+				//Initialize renderer color
+				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+				
+				//Initialize PNG loading
+				int imgFlags = IMG_INIT_PNG;
+				if(!(IMG_Init(imgFlags) & imgFlags))
+				{
+					printf("SDL_image could not intialize! SDL image Error: %s\n", IMG_GetError());
+					success = false;
+				}
+				
+				//Initialize SDL_ttf
+				if(TTF_Init() == -1)
+				{
+					printf("SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
+					success = false;
+				}
+			}
+		}
+	}
+
+	return success;
+}
+
+SDL_Texture* loadTexture(std::string path)
+{
+	//The final texture
+	SDL_Texture* newTexture = NULL;
+	
+	//Load image at specified path
+	SDL_Surface* loadedSurface = IMG_Load(path.c_str());
+	if(loadedSurface == NULL)
+	{
+		printf("Unable to load image %s! SDL image Error: %s\n", path.c_str(),IMG_GetError());
+	}
+	else
+	{
+		//Create texture from surface pixels 
+		newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
+		if(newTexture == NULL)
+		{
+			printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+		}
+		
+		//Get rid of old loaded surface
+		SDL_FreeSurface(loadedSurface);
+	}
+	
+	return newTexture;
+}
+
+bool loadMedia()
+{
+	//Loading success flag
+	bool success = true;
+	
+	//Open the font, only the widget tree needs it so the buttons work without it
+	gFont = TTF_OpenFont("lazy.ttf", UI_FONT_SIZE);
+	if(gFont == NULL)
+	{
+		printf("Warning: Unable to load lazy font, the F1 widget tree is disabled! SDL_ttf Error:%s\n", TTF_GetError());
+	}
 	
 	if(!gButtonSpriteSheetTexture.loadFromFile("button.png"))
 	{
@@ -474,10 +1874,13 @@ bool loadMedia()
 		}
 
 		//Set buttons in corners
-		gButtons[ 0 ].setPosition( 0, 0 );
-		gButtons[ 1 ].setPosition( SCREEN_WIDTH - BUTTON_WIDTH, 0 );
-		gButtons[ 2 ].setPosition( 0, SCREEN_HEIGHT - BUTTON_HEIGHT );
-		gButtons[ 3 ].setPosition( SCREEN_WIDTH - BUTTON_WIDTH, SCREEN_HEIGHT - BUTTON_HEIGHT );
+		layoutButtons( false );
+		
+		//Widget tree needs the font and the button sprites
+		if(gFont != NULL)
+		{
+			buildInterface();
+		}
 	}
 
 	return success;
@@ -485,13 +1888,23 @@ bool loadMedia()
 
 void close()
 {
+	//Report hit testing and widget tree work
+	gButtonIndex.printStats();
+	gInterface.printStats();
+	
+	//Free widget tree
+	gInterface.free();
+	
 	//Free loaded images
 	//gTextTexture.free();
 	gButtonSpriteSheetTexture.free();
 	
 	//Free global font
-	//TTF_CloseFont(gFont);
-	//gFont = NULL;
+	if(gFont != NULL)
+	{
+		TTF_CloseFont(gFont);
+		gFont = NULL;
+	}
 	
 	//Destroy window
 	SDL_DestroyRenderer(gRenderer);
@@ -500,11 +1913,167 @@ void close()
 	gRenderer = NULL;
 
 	//Quit SDL subsystems
-	//TTF_Quit();
+	TTF_Quit();
 	IMG_Quit();
 	SDL_Quit();
 }
 
+void runLoadBenchmark()
+{
+	//Needs an up to date cooked button sheet next to the image
+	LTexture texture;
+	if(!texture.loadFromCooked("button.png.tex", "button.png"))
+	{
+		printf("Run the asset cooker on button.png to compare load times\n");
+		return;
+	}
+	
+	//Decode, key and convert every time
+	Uint64 start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < BENCHMARK_LOADS; ++i)
+	{
+		texture.loadFromImage("button.png");
+	}
+	double imageTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() / BENCHMARK_LOADS;
+	
+	//The path every load takes, the staleness check, one read and one upload
+	start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < BENCHMARK_LOADS; ++i)
+	{
+		texture.loadFromFile("button.png");
+	}
+	double cookedTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() / BENCHMARK_LOADS;
+	
+	printf("button.png load: PNG %.3f ms, cooked %.3f ms, %.2fx faster\n", imageTime, cookedTime, imageTime / cookedTime);
+	
+	//Show the results where a windowed build can see them
+	std::stringstream caption;
+	caption << "button.png load: PNG=" << imageTime << "ms cooked=" << cookedTime << "ms";
+	SDL_SetWindowTitle(gWindow, caption.str().c_str());
+}
+
+bool getFileStamp(std::string path, Uint32& size, Uint32& modified)
+{
+	//Only the directory entry is read, the same stamp the asset cooker stores
+	struct stat status;
+	if(stat(path.c_str(), &status) != 0)
+	{
+		return false;
+	}
+	
+	size = (Uint32)status.st_size;
+	modified = (Uint32)status.st_mtime;
+	return true;
+}
+
+void layoutButtons(bool panel)
+{
+	gButtons.clear();
+	if(!panel)
+	{
+		//Set buttons in corners
+		gButtons.resize(TOTAL_BUTTONS);
+		gButtons[0].setPosition(0, 0);
+		gButtons[1].setPosition(SCREEN_WIDTH - BUTTON_WIDTH, 0);
+		gButtons[2].setPosition(0, SCREEN_HEIGHT - BUTTON_HEIGHT);
+		gButtons[3].setPosition(SCREEN_WIDTH - BUTTON_WIDTH, SCREEN_HEIGHT - BUTTON_HEIGHT);
+	}
+	else
+	{
+		//Tile the screen with small buttons
+		int w = SCREEN_WIDTH / PANEL_COLUMNS;
+		int h = SCREEN_HEIGHT / PANEL_ROWS;
+		gButtons.resize(PANEL_COLUMNS * PANEL_ROWS);
+		for(int y = 0; y < PANEL_ROWS; ++y)
+		{
+			for(int x = 0; x < PANEL_COLUMNS; ++x)
+			{
+				LButton& button = gButtons[y * PANEL_COLUMNS + x];
+				button.setPosition(x * w, y * h);
+				button.setSize(w, h);
+			}
+		}
+	}
+	
+	//Rebucket the new rects
+	gButtonIndex.build(&gButtons, SCREEN_WIDTH, SCREEN_HEIGHT, HIT_CELL_SIZE);
+}
+
+void buildInterface()
+{
+	//Whole window, stacked top to bottom
+	LWidget* root = new LWidget(WIDGET_BOX);
+	root->setColor(UI_BACKGROUND_COLOR);
+	
+	LWidget* title = root->addChild(new LWidget(WIDGET_LABEL));
+	title->setText("Items");
+	
+	//Name entry with its buttons
+	LWidget* entry = root->addChild(new LWidget(WIDGET_BOX));
+	entry->setVertical(false);
+	entry->setPreferredSize(0, TTF_FontHeight(gFont) + 2 * UI_TEXT_MARGIN + 2 * UI_PADDING);
+	gNameField = entry->addChild(new LWidget(WIDGET_TEXT_FIELD));
+	gNameField->setCallback(addListItem);
+	LWidget* add = entry->addChild(new LWidget(WIDGET_BUTTON));
+	add->setText("Add");
+	add->setPreferredSize(UI_BUTTON_WIDTH, 0);
+	add->setCallback(addListItem);
+	LWidget* remove = entry->addChild(new LWidget(WIDGET_BUTTON));
+	remove->setText("Remove");
+	remove->setPreferredSize(UI_BUTTON_WIDTH, 0);
+	remove->setCallback(removeListItem);
+	
+	//Takes the height left over
+	gItemList = root->addChild(new LWidget(WIDGET_LIST));
+	gItemList->setCallback(selectListItem);
+	for(int i = 0; i < UI_LIST_ITEMS; ++i)
+	{
+		std::stringstream item;
+		item << "Item " << i;
+		gItemList->addItem(item.str());
+	}
+	
+	//Status line, its labels resize with their text
+	LWidget* status = root->addChild(new LWidget(WIDGET_BOX));
+	status->setVertical(false);
+	status->setPreferredSize(0, TTF_FontHeight(gFont) + 2 * UI_TEXT_MARGIN + 2 * UI_PADDING);
+	gStatusLabel = status->addChild(new LWidget(WIDGET_LABEL));
+	gCountLabel = status->addChild(new LWidget(WIDGET_LABEL));
+	selectListItem(gItemList);
+	
+	SDL_Rect screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+	gInterface.setRoot(root, screen);
+}
+
+void addListItem(LWidget*)
+{
+	if(gNameField->getText().empty())
+	{
+		return;
+	}
+	
+	gItemList->addItem(gNameField->getText());
+	gNameField->setText("");
+	selectListItem(gItemList);
+}
+
+void removeListItem(LWidget*)
+{
+	gItemList->removeItem(gItemList->getSelected());
+	selectListItem(gItemList);
+}
+
+void selectListItem(LWidget*)
+{
+	//Only the status line lays out again
+	int selected = gItemList->getSelected();
+	gStatusLabel->setText(selected == -1 ? "Nothing selected" : "Selected " + gItemList->getItem(selected));
+	
+	std::stringstream count;
+	count << gItemList->getItemCount() << " items";
+	gCountLabel->setText(count.str());
+}
+
 int wmain( int argc, char* args[] )
 {
 	//Start up SDL and create window
@@ -533,6 +2102,12 @@ int wmain( int argc, char* args[] )
 			//Flip type
 			SDL_RendererFlip flipType = SDL_FLIP_NONE;
 			
+			//Whether the dense panel is shown
+			bool panel = false;
+			
+			//Whether the widget tree is shown instead of the buttons
+			bool showInterface = false;
+			
 			//While application is running
 			while( !quit )
 			{
@@ -545,10 +2120,33 @@ int wmain( int argc, char* args[] )
 						quit = true;
 					}
 					
-					//Handle button events
-					for(int i = 0; i < TOTAL_BUTTONS; ++i)
+					//Switch to the widget tree on F1, if the font for it loaded
+					if( e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F1 )
 					{
-						gButtons[i].handleEvent(&e);
+						showInterface = !showInterface && gFont != NULL;
+					}
+					//The widget tree takes every other event, typing included
+					else if( showInterface )
+					{
+						gInterface.handleEvent(&e);
+					}
+					else
+					{
+						//Run the load benchmark on B
+						if( e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_b )
+						{
+							runLoadBenchmark();
+						}
+						
+						//Switch between the corner buttons and the dense panel on G
+						if( e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_g )
+						{
+							panel = !panel;
+							layoutButtons( panel );
+						}
+						
+						//Handle button events
+						gButtonIndex.handleEvent(&e);
 					}
 				}
 				
@@ -556,10 +2154,18 @@ int wmain( int argc, char* args[] )
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 				SDL_RenderClear( gRenderer );
 				
+				//Render widget tree
+				if( showInterface )
+				{
+					gInterface.render();
+				}
 				//Render buttons
-				for(int i = 0; i < TOTAL_BUTTONS; ++i)
+				else
 				{
-					gButtons[i].render();
+					for(int i = 0; i < (int)gButtons.size(); ++i)
+					{
+						gButtons[i].render();
+					}
 				}
 				
 				//Update screen
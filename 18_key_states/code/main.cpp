@@ -1,14 +1,23 @@
-//Using SDL, SDL_image, standard IO, and strings
+//Using SDL, SDL_image, standard IO, strings, and string streams
 #include <SDL.h>
 #include <SDL_image.h>
 #include <stdio.h>
 #include <string>
 #include <cmath>
+#include <sstream>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Milliseconds of slack left between sampling input late and the next vsync
+const float LATCH_MARGIN = 2.0f;
+
+//Most queued input events checked when latching
+const int LATCH_PEEK_EVENTS = 64;
+
+//Size of the square drawn at the mouse position
+const int CURSOR_SIZE = 8;
 
 //Texture wrapper class 
 class LTexture
@@ -58,6 +67,73 @@ class LTexture
 		int mHeight;
 };
 
+//Samples input as late as possible before rendering and measures input to photon latency
+class LInputLatch
+{
+	public:
+		//Initializes variables
+		LInputLatch();
+		
+		//Sets the display refresh rate used to predict presents
+		void setRefreshRate(int refreshRate);
+		
+		//Switches between sampling at the start of the frame and just before rendering
+		void setLateLatch(bool lateLatch);
+		bool isLateLatch();
+		
+		//Notes input events taken off the queue
+		void handleEvent(SDL_Event& e);
+		
+		//Waits until just before the next present in late latch mode, then samples input
+		void sample();
+		
+		//Marks the render commands as built
+		void submitted();
+		
+		//Marks the frame as shown once presenting returns
+		void presented();
+		
+		//Sampled input
+		int getMouseX();
+		int getMouseY();
+		const Uint8* getKeyStates();
+		
+		//Input to photon latency since the mode was last switched
+		float getAverageLatency();
+		Uint32 getMaxLatency();
+		Uint32 getLatencyFrames();
+		
+	private:
+		//Whether input is sampled late
+		bool mLateLatch;
+		
+		//Sampled input
+		int mMouseX, mMouseY;
+		const Uint8* mKeyStates;
+		
+		//Oldest input not on screen yet and newest input already sampled
+		bool mInputPending;
+		Uint32 mPendingInput;
+		Uint32 mLatchedInput;
+		
+		//Frame timing for predicting the next present
+		float mFrameInterval;
+		float mRenderTime;
+		Uint64 mSampleTime;
+		Uint64 mPresentTime;
+		
+		//Latency counters in milliseconds
+		Uint32 mLatencyTotal;
+		Uint32 mLatencyMax;
+		Uint32 mLatencyFrames;
+		
+		//Records input waiting to be shown
+		void noteInput(Uint32 timestamp);
+		
+		//Milliseconds between two performance counter values
+		static float toMilliseconds(Uint64 start, Uint64 end);
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -79,6 +155,9 @@ LTexture gRightTexture;
 LTexture gLeftTexture;
 LTexture gUpTexture;
 
+//Latched keyboard and mouse input
+LInputLatch gInput;
+
 LTexture::LTexture()
 {
 	//Intiialize
@@ -233,6 +312,157 @@ void LTexture::setColor(Uint8 red, Uint8 green, Uint8 blue)
 }
 
 
+LInputLatch::LInputLatch()
+{
+	//Initialize
+	mLateLatch = true;
+	mMouseX = 0;
+	mMouseY = 0;
+	mKeyStates = NULL;
+	mInputPending = false;
+	mPendingInput = 0;
+	mLatchedInput = 0;
+	mFrameInterval = 1000.0f / 60;
+	mRenderTime = 0.0f;
+	mSampleTime = 0;
+	mPresentTime = 0;
+	mLatencyTotal = 0;
+	mLatencyMax = 0;
+	mLatencyFrames = 0;
+}
+
+void LInputLatch::setRefreshRate(int refreshRate)
+{
+	//Unknown rates are assumed to be 60Hz
+	mFrameInterval = 1000.0f / (refreshRate > 0 ? refreshRate : 60);
+}
+
+void LInputLatch::setLateLatch(bool lateLatch)
+{
+	//Measure each mode on its own
+	mLateLatch = lateLatch;
+	mLatencyTotal = 0;
+	mLatencyMax = 0;
+	mLatencyFrames = 0;
+}
+
+bool LInputLatch::isLateLatch()
+{
+	return mLateLatch;
+}
+
+void LInputLatch::handleEvent(SDL_Event& e)
+{
+	//Input a late sample already showed is not counted again
+	if(e.type >= SDL_KEYDOWN && e.type <= SDL_MOUSEBUTTONUP && e.common.timestamp > mLatchedInput)
+	{
+		noteInput(e.common.timestamp);
+	}
+}
+
+void LInputLatch::sample()
+{
+	if(mLateLatch && mPresentTime != 0)
+	{
+		//Sleep until just enough time is left to draw before the next vsync
+		float wait = mFrameInterval - toMilliseconds(mPresentTime, SDL_GetPerformanceCounter()) - mRenderTime - LATCH_MARGIN;
+		if(wait >= 1.0f)
+		{
+			SDL_Delay((Uint32)wait);
+		}
+	}
+	
+	//Pull in input that arrived since the queue was emptied
+	SDL_PumpEvents();
+	
+	//Queued input is shown by this frame even though it is handled next frame
+	SDL_Event events[LATCH_PEEK_EVENTS];
+	int count = SDL_PeepEvents(events, LATCH_PEEK_EVENTS, SDL_PEEKEVENT, SDL_KEYDOWN, SDL_MOUSEBUTTONUP);
+	for(int i = 0; i < count; ++i)
+	{
+		handleEvent(events[i]);
+		if(events[i].common.timestamp > mLatchedInput)
+		{
+			mLatchedInput = events[i].common.timestamp;
+		}
+	}
+	
+	//Read the current state
+	SDL_GetMouseState(&mMouseX, &mMouseY);
+	mKeyStates = SDL_GetKeyboardState(NULL);
+	mSampleTime = SDL_GetPerformanceCounter();
+}
+
+void LInputLatch::submitted()
+{
+	//Smooth out the time taken to build a frame
+	float renderTime = toMilliseconds(mSampleTime, SDL_GetPerformanceCounter());
+	mRenderTime = mRenderTime * 0.9f + renderTime * 0.1f;
+}
+
+void LInputLatch::presented()
+{
+	mPresentTime = SDL_GetPerformanceCounter();
+	
+	//The oldest input the frame reflects is now on screen
+	if(mInputPending)
+	{
+		Uint32 latency = SDL_GetTicks() - mPendingInput;
+		mLatencyTotal += latency;
+		if(latency > mLatencyMax)
+		{
+			mLatencyMax = latency;
+		}
+		++mLatencyFrames;
+		mInputPending = false;
+	}
+}
+
+int LInputLatch::getMouseX()
+{
+	return mMouseX;
+}
+
+int LInputLatch::getMouseY()
+{
+	return mMouseY;
+}
+
+const Uint8* LInputLatch::getKeyStates()
+{
+	return mKeyStates;
+}
+
+float LInputLatch::getAverageLatency()
+{
+	return mLatencyFrames > 0 ? (float)mLatencyTotal / mLatencyFrames : 0.0f;
+}
+
+Uint32 LInputLatch::getMaxLatency()
+{
+	return mLatencyMax;
+}
+
+Uint32 LInputLatch::getLatencyFrames()
+{
+	return mLatencyFrames;
+}
+
+void LInputLatch::noteInput(Uint32 timestamp)
+{
+	//Keep the oldest input waiting to be shown
+	if(!mInputPending)
+	{
+		mInputPending = true;
+		mPendingInput = timestamp;
+	}
+}
+
+float LInputLatch::toMilliseconds(Uint64 start, Uint64 end)
+{
+	return (float)((end - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
 bool init()
 {
 	//Initialization flag
@@ -267,6 +497,13 @@ bool init()
 				//Initialize renderer color
 				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 				
+				//Predict presents from the display refresh rate
+				SDL_DisplayMode displayMode;
+				if(SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(gWindow), &displayMode) == 0)
+				{
+					gInput.setRefreshRate(displayMode.refresh_rate);
+				}
+				
 				//Initialize PNG loading
 				int imgFlags = IMG_INIT_PNG;
 				if(!(IMG_Init(imgFlags) & imgFlags))
@@ -368,6 +605,10 @@ bool loadMedia()
 
 void close()
 {
+	//Report input to photon latency of the last mode
+	printf("%s latch: %.1f ms average, %u ms worst input to photon latency over %u frames\n", gInput.isLateLatch() ? "Late" : "Early", 
+		gInput.getAverageLatency(), gInput.getMaxLatency(), gInput.getLatencyFrames());
+	
 	//Free loaded images
 	//gTextTexture.free();
 	gPressTexture.free();
@@ -416,6 +657,9 @@ int wmain( int argc, char* args[] )
 			
 			//Current rendered text
 			LTexture* currentTexture = NULL;
+			
+			//When the latency caption was last updated
+			Uint32 captionTime = 0;
 
 			//While application is running
 			while( !quit )
@@ -428,10 +672,21 @@ int wmain( int argc, char* args[] )
 					{
 						quit = true;
 					}
+					//Toggle late latching on l
+					else if( e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_l )
+					{
+						gInput.setLateLatch( !gInput.isLateLatch() );
+					}
+					
+					//Time input for the latency counters
+					gInput.handleEvent( e );
 				}
 				
+				//Sample input right before drawing
+				gInput.sample();
+				
 				//Set texture based on current keystate
-				const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
+				const Uint8* currentKeyStates = gInput.getKeyStates();
 				if(currentKeyStates[SDL_SCANCODE_UP])
 				{
 					currentTexture = &gUpTexture;
@@ -460,8 +715,25 @@ int wmain( int argc, char* args[] )
 				//Render current texture
 				currentTexture->render(0, 0);
 				
+				//Render the cursor where the mouse was sampled
+				SDL_Rect cursor = { gInput.getMouseX() - CURSOR_SIZE / 2, gInput.getMouseY() - CURSOR_SIZE / 2, CURSOR_SIZE, CURSOR_SIZE };
+				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0x00, 0x00, 0xFF);
+				SDL_RenderFillRect(gRenderer, &cursor);
+				
 				//Update screen
+				gInput.submitted();
 				SDL_RenderPresent(gRenderer);
+				gInput.presented();
+				
+				//Show latency once a second
+				if(SDL_GetTicks() - captionTime >= 1000)
+				{
+					std::stringstream caption;
+					caption << "SDL Tutorial - " << (gInput.isLateLatch() ? "Late" : "Early") << " latch, input to photon "
+						<< gInput.getAverageLatency() << " ms average, " << gInput.getMaxLatency() << " ms worst";
+					SDL_SetWindowTitle(gWindow, caption.str().c_str());
+					captionTime = SDL_GetTicks();
+				}
 			}
 		}
 	}
@@ -15,6 +15,23 @@ const int SCREEN_HEIGHT = 480;
 //Analog joystick dead zone
 const int JOYSTICK_DEAD_ZONE = 8000;
 
+//Most controllers read at once
+const int MAX_CONTROLLERS = 4;
+
+//Snapshot of one controller taken once per frame
+struct LPadState
+{
+	//Whether a device is in this slot
+	bool connected;
+
+	//Left stick direction past the dead zone
+	int xDir;
+	int yDir;
+
+	//Held buttons, one bit per button
+	Uint32 buttons;
+};
+
 //Texture wrapper class
 class LTexture
 {
@@ -61,6 +78,63 @@ class LTexture
 		int mHeight;
 };
 
+//Opens controllers as they are plugged in and reads them all once per frame
+class LControllerManager
+{
+	public:
+		//Initializes variables
+		LControllerManager();
+
+		//Closes devices
+		~LControllerManager();
+
+		//Adds controller mappings from a file if it exists
+		void loadMappings( std::string path );
+
+		//Opens and closes devices on hot-plug events
+		void handleEvent( SDL_Event& e );
+
+		//Reads every connected device into its state
+		void update();
+
+		//Gets the last read state of a slot
+		const LPadState& getState( int slot );
+
+		//Gets the number of connected devices
+		int getCount();
+
+		//Closes every device
+		void free();
+
+	private:
+		//Devices mapped through the game controller API
+		SDL_GameController* mControllers[ MAX_CONTROLLERS ];
+
+		//Devices without a mapping, read as raw joysticks
+		SDL_Joystick* mJoysticks[ MAX_CONTROLLERS ];
+
+		//Instance identifiers removal events refer to
+		SDL_JoystickID mInstanceIDs[ MAX_CONTROLLERS ];
+
+		//States read by the last update
+		LPadState mStates[ MAX_CONTROLLERS ];
+
+		//Connected devices
+		int mCount;
+
+		//Puts an opened device in the first free slot
+		void addDevice( SDL_GameController* controller, SDL_Joystick* joystick );
+
+		//Closes the device in a slot
+		void removeDevice( int slot );
+
+		//Finds the slot of a device instance, -1 if none
+		int findSlot( SDL_JoystickID instanceID );
+
+		//Turns an axis value into a direction past the dead zone
+		static int getDirection( Sint16 value );
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -79,8 +153,8 @@ SDL_Renderer* gRenderer = NULL;
 //Scene textures
 LTexture gArrowTexture;
 
-//Game Controller 1 handler
-SDL_Joystick* gGameController = NULL;
+//Connected game controllers
+LControllerManager gControllers;
 
 
 LTexture::LTexture()
@@ -231,13 +305,243 @@ int LTexture::getHeight()
 	return mHeight;
 }
 
+LControllerManager::LControllerManager()
+{
+	//Initialize
+	for( int i = 0; i < MAX_CONTROLLERS; ++i )
+	{
+		mControllers[ i ] = NULL;
+		mJoysticks[ i ] = NULL;
+		mInstanceIDs[ i ] = -1;
+		mStates[ i ].connected = false;
+		mStates[ i ].xDir = 0;
+		mStates[ i ].yDir = 0;
+		mStates[ i ].buttons = 0;
+	}
+	mCount = 0;
+}
+
+LControllerManager::~LControllerManager()
+{
+	//Deallocate
+	free();
+}
+
+void LControllerManager::loadMappings( std::string path )
+{
+	//Mappings are optional, SDL knows the common pads already
+	SDL_RWops* file = SDL_RWFromFile( path.c_str(), "rb" );
+	if( file != NULL )
+	{
+		int mappings = SDL_GameControllerAddMappingsFromRW( file, 1 );
+		if( mappings < 0 )
+		{
+			printf( "Warning: Unable to load controller mappings! SDL Error: %s\n", SDL_GetError() );
+		}
+		else
+		{
+			printf( "Loaded %d controller mappings\n", mappings );
+		}
+	}
+}
+
+void LControllerManager::handleEvent( SDL_Event& e )
+{
+	//Mapped device plugged in, also sent at startup for connected pads
+	if( e.type == SDL_CONTROLLERDEVICEADDED )
+	{
+		SDL_GameController* controller = SDL_GameControllerOpen( e.cdevice.which );
+		if( controller == NULL )
+		{
+			printf( "Warning: Unable to open game controller! SDL Error: %s\n", SDL_GetError() );
+		}
+		else
+		{
+			addDevice( controller, NULL );
+		}
+	}
+	//Unmapped device plugged in, mapped ones get a controller event as well
+	else if( e.type == SDL_JOYDEVICEADDED && !SDL_IsGameController( e.jdevice.which ) )
+	{
+		SDL_Joystick* joystick = SDL_JoystickOpen( e.jdevice.which );
+		if( joystick == NULL )
+		{
+			printf( "Warning: Unable to open joystick! SDL Error: %s\n", SDL_GetError() );
+		}
+		else
+		{
+			addDevice( NULL, joystick );
+		}
+	}
+	//Device unplugged, both removal events carry the instance identifier
+	else if( e.type == SDL_CONTROLLERDEVICEREMOVED || e.type == SDL_JOYDEVICEREMOVED )
+	{
+		int slot = findSlot( e.type == SDL_CONTROLLERDEVICEREMOVED ? e.cdevice.which : e.jdevice.which );
+		if( slot >= 0 )
+		{
+			removeDevice( slot );
+		}
+	}
+}
+
+void LControllerManager::update()
+{
+	//Read every device in one pass, events have already pumped their state
+	for( int i = 0; i < MAX_CONTROLLERS; ++i )
+	{
+		LPadState& state = mStates[ i ];
+		state.buttons = 0;
+		if( mControllers[ i ] != NULL )
+		{
+			state.xDir = getDirection( SDL_GameControllerGetAxis( mControllers[ i ], SDL_CONTROLLER_AXIS_LEFTX ) );
+			state.yDir = getDirection( SDL_GameControllerGetAxis( mControllers[ i ], SDL_CONTROLLER_AXIS_LEFTY ) );
+			for( int b = 0; b < SDL_CONTROLLER_BUTTON_MAX; ++b )
+			{
+				if( SDL_GameControllerGetButton( mControllers[ i ], (SDL_GameControllerButton)b ) )
+				{
+					state.buttons |= 1u << b;
+				}
+			}
+		}
+		else if( mJoysticks[ i ] != NULL )
+		{
+			state.xDir = getDirection( SDL_JoystickGetAxis( mJoysticks[ i ], 0 ) );
+			state.yDir = getDirection( SDL_JoystickGetAxis( mJoysticks[ i ], 1 ) );
+			int buttons = SDL_JoystickNumButtons( mJoysticks[ i ] );
+			for( int b = 0; b < buttons && b < 32; ++b )
+			{
+				if( SDL_JoystickGetButton( mJoysticks[ i ], b ) )
+				{
+					state.buttons |= 1u << b;
+				}
+			}
+		}
+		else
+		{
+			state.xDir = 0;
+			state.yDir = 0;
+		}
+	}
+}
+
+const LPadState& LControllerManager::getState( int slot )
+{
+	return mStates[ slot ];
+}
+
+int LControllerManager::getCount()
+{
+	return mCount;
+}
+
+void LControllerManager::free()
+{
+	for( int i = 0; i < MAX_CONTROLLERS; ++i )
+	{
+		removeDevice( i );
+	}
+}
+
+void LControllerManager::addDevice( SDL_GameController* controller, SDL_Joystick* joystick )
+{
+	//Startup can report a device that is already open
+	SDL_Joystick* device = controller != NULL ? SDL_GameControllerGetJoystick( controller ) : joystick;
+	SDL_JoystickID instanceID = SDL_JoystickInstanceID( device );
+	int slot = findSlot( instanceID );
+
+	//Otherwise take the first free slot
+	for( int i = 0; i < MAX_CONTROLLERS && slot < 0; ++i )
+	{
+		if( !mStates[ i ].connected )
+		{
+			slot = i;
+			mControllers[ i ] = controller;
+			mJoysticks[ i ] = joystick;
+			mInstanceIDs[ i ] = instanceID;
+			mStates[ i ].connected = true;
+			++mCount;
+			printf( "Controller %d connected: %s\n", i, controller != NULL ? SDL_GameControllerName( controller ) : SDL_JoystickName( joystick ) );
+			return;
+		}
+	}
+
+	//Already open or no room, let go of the extra reference
+	if( slot < 0 )
+	{
+		printf( "Warning: More than %d controllers connected!\n", MAX_CONTROLLERS );
+	}
+	if( controller != NULL )
+	{
+		SDL_GameControllerClose( controller );
+	}
+	else
+	{
+		SDL_JoystickClose( joystick );
+	}
+}
+
+void LControllerManager::removeDevice( int slot )
+{
+	if( !mStates[ slot ].connected )
+	{
+		return;
+	}
+
+	if( mControllers[ slot ] != NULL )
+	{
+		SDL_GameControllerClose( mControllers[ slot ] );
+	}
+	else
+	{
+		SDL_JoystickClose( mJoysticks[ slot ] );
+	}
+	mControllers[ slot ] = NULL;
+	mJoysticks[ slot ] = NULL;
+	mInstanceIDs[ slot ] = -1;
+	mStates[ slot ].connected = false;
+	mStates[ slot ].xDir = 0;
+	mStates[ slot ].yDir = 0;
+	mStates[ slot ].buttons = 0;
+	--mCount;
+	printf( "Controller %d disconnected\n", slot );
+}
+
+int LControllerManager::findSlot( SDL_JoystickID instanceID )
+{
+	for( int i = 0; i < MAX_CONTROLLERS; ++i )
+	{
+		if( mStates[ i ].connected && mInstanceIDs[ i ] == instanceID )
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int LControllerManager::getDirection( Sint16 value )
+{
+	//Left or up of dead zone
+	if( value < -JOYSTICK_DEAD_ZONE )
+	{
+		return -1;
+	}
+	//Right or down of dead zone
+	else if( value > JOYSTICK_DEAD_ZONE )
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
 bool init()
 {
 	//Initialization flag
 	bool success = true;
 
 	//Initialize SDL
-	if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_JOYSTICK ) < 0 )
+	if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER ) < 0 )
 	{
 		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
 		success = false;
@@ -250,20 +554,14 @@ bool init()
 			printf( "Warning: Linear texture filtering not enabled!" );
 		}
 
-		//Check for joysticks
+		//Check for joysticks, ones connected now or later are opened from their added events
 		if( SDL_NumJoysticks() < 1 )
 		{
 			printf( "Warning: No joysticks connected!\n" );
 		}
-		else
-		{
-			//Load joystick
-			gGameController = SDL_JoystickOpen( 0 );
-			if( gGameController == NULL )
-			{
-				printf( "Warning: Unable to open game controller! SDL Error: %s\n", SDL_GetError() );
-			}
-		}
+
+		//Pick up mappings for less common pads
+		gControllers.loadMappings( "gamecontrollerdb.txt" );
 
 		//Create window
 		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
@@ -320,9 +618,8 @@ void close()
 	//Free loaded images
 	gArrowTexture.free();
 
-	//Close game controller
-	SDL_JoystickClose( gGameController );
-	gGameController = NULL;
+	//Close game controllers
+	gControllers.free();
 
 	//Destroy window	
 	SDL_DestroyRenderer( gRenderer );
@@ -357,10 +654,6 @@ int wmain( int argc, char* args[] )
 			//Event handler
 			SDL_Event e;
 
-			//Normalized direction
-			int xDir = 0;
-			int yDir = 0;
-
 			//While application is running
 			while( !quit )
 			{
@@ -372,66 +665,53 @@ int wmain( int argc, char* args[] )
 					{
 						quit = true;
 					}
-					else if( e.type == SDL_JOYAXISMOTION )
-					{
-						//Motion on controller 0
-						if( e.jaxis.which == 0 )
-						{						
-							//X axis motion
-							if( e.jaxis.axis == 0 )
-							{
-								//Left of dead zone
-								if( e.jaxis.value < -JOYSTICK_DEAD_ZONE )
-								{
-									xDir = -1;
-								}
-								//Right of dead zone
-								else if( e.jaxis.value > JOYSTICK_DEAD_ZONE )
-								{
-									xDir =  1;
-								}
-								else
-								{
-									xDir = 0;
-								}
-							}
-							//Y axis motion
-							else if( e.jaxis.axis == 1 )
-							{
-								//Below of dead zone
-								if( e.jaxis.value < -JOYSTICK_DEAD_ZONE )
-								{
-									yDir = -1;
-								}
-								//Above of dead zone
-								else if( e.jaxis.value > JOYSTICK_DEAD_ZONE )
-								{
-									yDir =  1;
-								}
-								else
-								{
-									yDir = 0;
-								}
-							}
-						}
-					}
+
+					//Handle controllers coming and going
+					gControllers.handleEvent( e );
 				}
 
+				//Read all controllers at once
+				gControllers.update();
+
 				//Clear screen
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 				SDL_RenderClear( gRenderer );
 
-				//Calculate angle
-				double joystickAngle = atan2( (double)yDir, (double)xDir ) * ( 180.0 / M_PI );
-				
-				//Correct angle
-				if( xDir == 0 && yDir == 0 )
+				//Show one arrow per controller, or a resting one when none are connected
+				int arrows = gControllers.getCount() > 0 ? gControllers.getCount() : 1;
+				int arrow = 0;
+				for( int i = 0; i < MAX_CONTROLLERS && arrow < arrows; ++i )
 				{
-					joystickAngle = 0;
-				}
+					const LPadState& pad = gControllers.getState( i );
+					if( !pad.connected && gControllers.getCount() > 0 )
+					{
+						continue;
+					}
+
+					//Calculate angle
+					double joystickAngle = atan2( (double)pad.yDir, (double)pad.xDir ) * ( 180.0 / M_PI );
+					
+					//Correct angle
+					if( pad.xDir == 0 && pad.yDir == 0 )
+					{
+						joystickAngle = 0;
+					}
+
+					//Highlight the arrow while any button is held
+					if( pad.buttons != 0 )
+					{
+						gArrowTexture.setColor( 0xFF, 0x80, 0x80 );
+					}
+					else
+					{
+						gArrowTexture.setColor( 0xFF, 0xFF, 0xFF );
+					}
 
-				//Render joystick 8 way angle
-				gArrowTexture.render( ( SCREEN_WIDTH - gArrowTexture.getWidth() ) / 2, ( SCREEN_HEIGHT - gArrowTexture.getHeight() ) / 2, NULL, joystickAngle );
+					//Render joystick 8 way angle, arrows spread evenly across the screen
+					int x = SCREEN_WIDTH * ( 2 * arrow + 1 ) / ( 2 * arrows ) - gArrowTexture.getWidth() / 2;
+					gArrowTexture.render( x, ( SCREEN_HEIGHT - gArrowTexture.getHeight() ) / 2, NULL, joystickAngle );
+					++arrow;
+				}
 
 				//Update screen
 				SDL_RenderPresent( gRenderer );
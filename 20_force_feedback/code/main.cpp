@@ -15,6 +15,37 @@ const int SCREEN_HEIGHT = 480;
 //Analog joystick dead zone
 const int JOYSTICK_DEAD_ZONE = 8000;
 
+//Feedback the game can ask for
+enum LHapticEffect
+{
+	HAPTIC_EFFECT_TAP = 0,
+	HAPTIC_EFFECT_RUMBLE = 1,
+	HAPTIC_EFFECT_IMPACT = 2,
+	HAPTIC_EFFECT_TOTAL = 3
+};
+
+//How an effect plays
+struct LHapticDefinition
+{
+	//Strong and weak motor strength from 0 to 1
+	float strong;
+	float weak;
+
+	//Milliseconds the effect lasts
+	Uint32 length;
+
+	//Effects only interrupt playing ones of lower or equal priority
+	int priority;
+};
+
+//Effect definitions, uploaded to the device once
+const LHapticDefinition HAPTIC_DEFINITIONS[ HAPTIC_EFFECT_TOTAL ] =
+{
+	{ 0.0f, 0.5f, 100, 0 },
+	{ 0.75f, 0.75f, 500, 1 },
+	{ 1.0f, 0.5f, 250, 2 }
+};
+
 //Texture wrapper class
 class LTexture
 {
@@ -61,6 +92,61 @@ class LTexture
 		int mHeight;
 };
 
+//Plays cached haptic effects from a scheduler thread so gameplay never waits on the driver
+class LHapticScheduler
+{
+	public:
+		//Initializes variables
+		LHapticScheduler();
+
+		//Deallocates memory
+		~LHapticScheduler();
+
+		//Opens the joystick's haptic device, uploads the effects, and starts the scheduler
+		bool open( SDL_Joystick* joystick );
+
+		//Stops the scheduler and releases the device
+		void free();
+
+		//Asks for an effect without waiting on the driver
+		void play( LHapticEffect effect );
+
+		//Prints how requests were handled, after free() so the scheduler is no longer counting
+		void printStats();
+
+	private:
+		//Uploads the effect definitions in a form the device supports
+		bool uploadEffects();
+
+		//Starts an effect, stopping the one playing
+		void run( int effect );
+
+		//Handles requests on the scheduler thread
+		static int scheduler( void* data );
+
+		//The haptic device
+		SDL_Haptic* mHaptic;
+
+		//Uploaded effect handles, -1 plays through simple rumble
+		int mEffectIDs[ HAPTIC_EFFECT_TOTAL ];
+
+		//Effect playing and when it ends, only touched by the scheduler
+		int mActive;
+		Uint32 mActiveEnd;
+
+		//Scheduler thread and its requests, one bit per effect
+		SDL_Thread* mThread;
+		SDL_mutex* mLock;
+		SDL_cond* mWake;
+		Uint32 mRequests;
+		bool mQuit;
+
+		//Requests played, restarted while already playing, and dropped for a stronger effect
+		Uint32 mPlayed;
+		Uint32 mMerged;
+		Uint32 mDropped;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -81,7 +167,7 @@ LTexture gBackgroundTexture;
 
 //Game Controller 1 handler with force feedback
 SDL_Joystick* gGameController = NULL;
-SDL_Haptic* gControllerHaptic = NULL;
+LHapticScheduler gHaptics;
 
 
 LTexture::LTexture()
@@ -232,6 +318,272 @@ int LTexture::getHeight()
 	return mHeight;
 }
 
+LHapticScheduler::LHapticScheduler()
+{
+	//Initialize
+	mHaptic = NULL;
+	for( int i = 0; i < HAPTIC_EFFECT_TOTAL; ++i )
+	{
+		mEffectIDs[ i ] = -1;
+	}
+	mActive = -1;
+	mActiveEnd = 0;
+	mThread = NULL;
+	mLock = NULL;
+	mWake = NULL;
+	mRequests = 0;
+	mQuit = false;
+	mPlayed = 0;
+	mMerged = 0;
+	mDropped = 0;
+}
+
+LHapticScheduler::~LHapticScheduler()
+{
+	//Deallocate
+	free();
+}
+
+bool LHapticScheduler::open( SDL_Joystick* joystick )
+{
+	//Get rid of preexisting device
+	free();
+
+	//Get controller haptic device
+	mHaptic = SDL_HapticOpenFromJoystick( joystick );
+	if( mHaptic == NULL )
+	{
+		printf( "Warning: Controller does not support haptics! SDL Error: %s\n", SDL_GetError() );
+		return false;
+	}
+
+	//Driver work happens once here instead of on every request
+	if( !uploadEffects() )
+	{
+		free();
+		return false;
+	}
+
+	//Start the scheduler
+	mLock = SDL_CreateMutex();
+	mWake = SDL_CreateCond();
+	mQuit = false;
+	if( mLock != NULL && mWake != NULL )
+	{
+		mThread = SDL_CreateThread( scheduler, "HapticScheduler", this );
+	}
+	if( mThread == NULL )
+	{
+		printf( "Warning: Unable to start haptic scheduler! SDL Error: %s\n", SDL_GetError() );
+		free();
+		return false;
+	}
+
+	return true;
+}
+
+void LHapticScheduler::free()
+{
+	//Stop the scheduler
+	if( mThread != NULL )
+	{
+		SDL_LockMutex( mLock );
+		mQuit = true;
+		SDL_CondSignal( mWake );
+		SDL_UnlockMutex( mLock );
+		SDL_WaitThread( mThread, NULL );
+		mThread = NULL;
+	}
+	if( mWake != NULL )
+	{
+		SDL_DestroyCond( mWake );
+		mWake = NULL;
+	}
+	if( mLock != NULL )
+	{
+		SDL_DestroyMutex( mLock );
+		mLock = NULL;
+	}
+
+	//Release the cached effects and the device
+	if( mHaptic != NULL )
+	{
+		for( int i = 0; i < HAPTIC_EFFECT_TOTAL; ++i )
+		{
+			if( mEffectIDs[ i ] >= 0 )
+			{
+				SDL_HapticDestroyEffect( mHaptic, mEffectIDs[ i ] );
+				mEffectIDs[ i ] = -1;
+			}
+		}
+		SDL_HapticClose( mHaptic );
+		mHaptic = NULL;
+	}
+	mActive = -1;
+	mRequests = 0;
+}
+
+void LHapticScheduler::play( LHapticEffect effect )
+{
+	if( mThread == NULL )
+	{
+		return;
+	}
+
+	//Hand the request over, repeats before the scheduler wakes are merged
+	SDL_LockMutex( mLock );
+	if( mRequests & ( 1 << effect ) )
+	{
+		++mMerged;
+	}
+	mRequests |= 1 << effect;
+	SDL_CondSignal( mWake );
+	SDL_UnlockMutex( mLock );
+}
+
+void LHapticScheduler::printStats()
+{
+	printf( "Haptics: %u effects played, %u merged, %u dropped\n", mPlayed, mMerged, mDropped );
+}
+
+bool LHapticScheduler::uploadEffects()
+{
+	unsigned int supported = SDL_HapticQuery( mHaptic );
+	for( int i = 0; i < HAPTIC_EFFECT_TOTAL; ++i )
+	{
+		const LHapticDefinition& definition = HAPTIC_DEFINITIONS[ i ];
+		SDL_HapticEffect effect;
+		SDL_memset( &effect, 0, sizeof( effect ) );
+
+		//Drive both motors separately when possible
+		if( supported & SDL_HAPTIC_LEFTRIGHT )
+		{
+			effect.type = SDL_HAPTIC_LEFTRIGHT;
+			effect.leftright.length = definition.length;
+			effect.leftright.large_magnitude = (Uint16)( definition.strong * 0xFFFF );
+			effect.leftright.small_magnitude = (Uint16)( definition.weak * 0xFFFF );
+		}
+		//Otherwise a sine wave at the stronger of the two
+		else if( supported & SDL_HAPTIC_SINE )
+		{
+			effect.type = SDL_HAPTIC_SINE;
+			effect.periodic.direction.type = SDL_HAPTIC_CARTESIAN;
+			effect.periodic.direction.dir[ 0 ] = 1;
+			effect.periodic.length = definition.length;
+			effect.periodic.period = 20;
+			effect.periodic.magnitude = (Sint16)( SDL_max( definition.strong, definition.weak ) * 0x7FFF );
+		}
+		else
+		{
+			break;
+		}
+
+		mEffectIDs[ i ] = SDL_HapticNewEffect( mHaptic, &effect );
+		if( mEffectIDs[ i ] < 0 )
+		{
+			printf( "Warning: Unable to upload haptic effect %d! SDL Error: %s\n", i, SDL_GetError() );
+		}
+	}
+
+	//Anything not uploaded falls back on simple rumble
+	for( int i = 0; i < HAPTIC_EFFECT_TOTAL; ++i )
+	{
+		if( mEffectIDs[ i ] < 0 )
+		{
+			if( SDL_HapticRumbleInit( mHaptic ) < 0 )
+			{
+				printf( "Warning: Unable to initialize rumble! SDL Error: %s\n", SDL_GetError() );
+				return false;
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+void LHapticScheduler::run( int effect )
+{
+	//Stop the effect playing unless it is being restarted
+	if( mActive >= 0 && mActive != effect && mEffectIDs[ mActive ] >= 0 )
+	{
+		SDL_HapticStopEffect( mHaptic, mEffectIDs[ mActive ] );
+	}
+
+	//Play the cached effect
+	int result = 0;
+	if( mEffectIDs[ effect ] >= 0 )
+	{
+		result = SDL_HapticRunEffect( mHaptic, mEffectIDs[ effect ], 1 );
+	}
+	else
+	{
+		result = SDL_HapticRumblePlay( mHaptic, SDL_max( HAPTIC_DEFINITIONS[ effect ].strong, HAPTIC_DEFINITIONS[ effect ].weak ), HAPTIC_DEFINITIONS[ effect ].length );
+	}
+	if( result != 0 )
+	{
+		printf( "Warning: Unable to play haptic effect! %s\n", SDL_GetError() );
+	}
+
+	mActive = effect;
+	mActiveEnd = SDL_GetTicks() + HAPTIC_DEFINITIONS[ effect ].length;
+	++mPlayed;
+}
+
+int LHapticScheduler::scheduler( void* data )
+{
+	LHapticScheduler* haptics = (LHapticScheduler*)data;
+
+	SDL_LockMutex( haptics->mLock );
+	while( !haptics->mQuit )
+	{
+		//Sleep until requests arrive
+		if( haptics->mRequests == 0 )
+		{
+			SDL_CondWait( haptics->mWake, haptics->mLock );
+			continue;
+		}
+		Uint32 requests = haptics->mRequests;
+		haptics->mRequests = 0;
+
+		//Driver calls happen without holding up the game
+		SDL_UnlockMutex( haptics->mLock );
+
+		//Only the highest priority request is played
+		int effect = -1;
+		for( int i = 0; i < HAPTIC_EFFECT_TOTAL; ++i )
+		{
+			if( requests & ( 1 << i ) )
+			{
+				if( effect >= 0 )
+				{
+					++haptics->mDropped;
+				}
+				if( effect < 0 || HAPTIC_DEFINITIONS[ i ].priority >= HAPTIC_DEFINITIONS[ effect ].priority )
+				{
+					effect = i;
+				}
+			}
+		}
+
+		//A stronger effect still playing is not cut short
+		bool playing = haptics->mActive >= 0 && (Sint32)( SDL_GetTicks() - haptics->mActiveEnd ) < 0;
+		if( playing && HAPTIC_DEFINITIONS[ haptics->mActive ].priority > HAPTIC_DEFINITIONS[ effect ].priority )
+		{
+			++haptics->mDropped;
+		}
+		else
+		{
+			haptics->run( effect );
+		}
+
+		SDL_LockMutex( haptics->mLock );
+	}
+	SDL_UnlockMutex( haptics->mLock );
+
+	return 0;
+}
+
 bool init()
 {
 	//Initialization flag
@@ -266,19 +618,10 @@ bool init()
 			}
 			else
 			{
-				//Get controller haptic device
-				gControllerHaptic = SDL_HapticOpenFromJoystick(gGameController);
-				if(gControllerHaptic == NULL)
+				//Upload effects and start scheduling them
+				if( !gHaptics.open( gGameController ) )
 				{
-					printf("Warning: Controller does not support haptics! SDL Error: %s\n", SDL_GetError());
-				}
-				else
-				{
-					//Get initialize rumble
-					if(SDL_HapticRumbleInit(gControllerHaptic) < 0)
-					{
-						printf("Warning: Unable to initialize rumble! SDL Error: %s\n", SDL_GetError());
-					}
+					printf( "Warning: Force feedback disabled!\n" );
 				}
 			}
 		}
@@ -338,11 +681,11 @@ void close()
 	//Free loaded images
 	gBackgroundTexture.free();
 
-	//Close game controller with haptics
-	SDL_HapticClose(gControllerHaptic);
+	//Close game controller with haptics, the stats are final once the scheduler has stopped
+	gHaptics.free();
+	gHaptics.printStats();
 	SDL_JoystickClose( gGameController );
 	gGameController = NULL;
-	gControllerHaptic = NULL;
 
 	//Destroy window	
 	SDL_DestroyRenderer( gRenderer );
@@ -395,11 +738,8 @@ int wmain( int argc, char* args[] )
 					//Joystick button press
 					else if(e.type == SDL_JOYBUTTONDOWN)
 					{
-						//Play rumble at 75% strength for 500 milliseconds
-						if(SDL_HapticRumblePlay(gControllerHaptic, 0.75, 500) != 0)
-						{
-							printf("Warning: Unable to play rumble! %s\n", SDL_GetError());
-						}
+						//Each button asks for a different effect, the scheduler plays it
+						gHaptics.play( (LHapticEffect)( e.jbutton.button % HAPTIC_EFFECT_TOTAL ) );
 					}
 				}
 
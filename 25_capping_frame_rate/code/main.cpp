@@ -3,12 +3,16 @@
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <sstream>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
+
+//Most textures a streaming LTexture cycles through
+const int MAX_STREAM_BUFFERS = 3;
 const int SCREEN_FPS = 60;
 const int SCREEN_TICKS_PER_FRAME = 1000 / SCREEN_FPS;
 
@@ -30,6 +34,12 @@ class LTexture
 		bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
 		#endif
 
+		//Switches to streaming mode, allocating a ring of textures that later updates are written into
+		bool createStreaming( int width, int height, int buffers = 2 );
+
+		//Writes surface pixels into the next texture in the ring
+		bool updateStreaming( SDL_Surface* surface );
+
 		//Deallocates texture
 		void free();
 
@@ -56,6 +66,25 @@ class LTexture
 		//Image dimensions
 		int mWidth;
 		int mHeight;
+
+		//Streaming ring, mTexture is the one last written
+		SDL_Texture* mStreamTextures[ MAX_STREAM_BUFFERS ];
+		int mStreamBuffers;
+		int mStreamIndex;
+
+		//Streaming ring texture dimensions
+		int mStreamWidth;
+		int mStreamHeight;
+
+		//Modulation and blending, kept so every texture in the ring matches
+		Uint8 mRed;
+		Uint8 mGreen;
+		Uint8 mBlue;
+		Uint8 mAlpha;
+		SDL_BlendMode mBlendMode;
+
+		//Applies the kept modulation and blending to a texture
+		void applyState( SDL_Texture* texture );
 };
 
 //The application time based timer
@@ -117,6 +146,19 @@ LTexture::LTexture()
 	mTexture = NULL;
 	mWidth = 0;
 	mHeight = 0;
+	for( int i = 0; i < MAX_STREAM_BUFFERS; ++i )
+	{
+		mStreamTextures[ i ] = NULL;
+	}
+	mStreamBuffers = 0;
+	mStreamIndex = 0;
+	mStreamWidth = 0;
+	mStreamHeight = 0;
+	mRed = 0xFF;
+	mGreen = 0xFF;
+	mBlue = 0xFF;
+	mAlpha = 0xFF;
+	mBlendMode = SDL_BLENDMODE_BLEND;
 }
 
 LTexture::~LTexture()
@@ -169,6 +211,21 @@ bool LTexture::loadFromFile( std::string path )
 #ifdef _SDL_TTF_H
 bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor )
 {
+	//Streaming textures are rewritten in place
+	if( mStreamBuffers > 0 )
+	{
+		SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
+		if( textSurface == NULL )
+		{
+			printf( "Unable to render text surface! SDL_ttf Error: %s\n", TTF_GetError() );
+			return false;
+		}
+
+		bool success = updateStreaming( textSurface );
+		SDL_FreeSurface( textSurface );
+		return success;
+	}
+
 	//Get rid of preexisting texture
 	free();
 
@@ -203,8 +260,110 @@ bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColo
 }
 #endif
 
+bool LTexture::createStreaming( int width, int height, int buffers )
+{
+	//Get rid of preexisting texture
+	free();
+
+	//Allocate the whole ring up front so updates never create textures
+	buffers = SDL_max( 1, SDL_min( buffers, MAX_STREAM_BUFFERS ) );
+	for( int i = 0; i < buffers; ++i )
+	{
+		mStreamTextures[ i ] = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height );
+		if( mStreamTextures[ i ] == NULL )
+		{
+			printf( "Unable to create streaming texture! SDL Error: %s\n", SDL_GetError() );
+			mStreamBuffers = i;
+			free();
+			return false;
+		}
+		applyState( mStreamTextures[ i ] );
+	}
+	mStreamBuffers = buffers;
+	mStreamIndex = 0;
+	mStreamWidth = width;
+	mStreamHeight = height;
+
+	//Nothing written yet
+	mTexture = mStreamTextures[ 0 ];
+	mWidth = 0;
+	mHeight = 0;
+	return true;
+}
+
+bool LTexture::updateStreaming( SDL_Surface* surface )
+{
+	//Grow the ring if the new contents do not fit
+	if( surface->w > mStreamWidth || surface->h > mStreamHeight )
+	{
+		if( !createStreaming( SDL_max( surface->w, mStreamWidth ), SDL_max( surface->h, mStreamHeight ), mStreamBuffers ) )
+		{
+			return false;
+		}
+	}
+
+	//Match the texture format
+	SDL_Surface* formattedSurface = surface;
+	if( surface->format->format != SDL_PIXELFORMAT_ARGB8888 )
+	{
+		formattedSurface = SDL_ConvertSurfaceFormat( surface, SDL_PIXELFORMAT_ARGB8888, 0 );
+		if( formattedSurface == NULL )
+		{
+			printf( "Unable to convert streaming pixels! SDL Error: %s\n", SDL_GetError() );
+			return false;
+		}
+	}
+
+	//Write into the next texture in the ring so the ones still being drawn are left alone
+	mStreamIndex = ( mStreamIndex + 1 ) % mStreamBuffers;
+	SDL_Rect area = { 0, 0, formattedSurface->w, formattedSurface->h };
+	void* pixels = NULL;
+	int pitch = 0;
+	bool success = SDL_LockTexture( mStreamTextures[ mStreamIndex ], &area, &pixels, &pitch ) == 0;
+	if( success )
+	{
+		for( int y = 0; y < area.h; ++y )
+		{
+			memcpy( (Uint8*)pixels + y * pitch, (Uint8*)formattedSurface->pixels + y * formattedSurface->pitch, area.w * sizeof( Uint32 ) );
+		}
+		SDL_UnlockTexture( mStreamTextures[ mStreamIndex ] );
+
+		//Show the new contents
+		mTexture = mStreamTextures[ mStreamIndex ];
+		mWidth = area.w;
+		mHeight = area.h;
+	}
+	else
+	{
+		printf( "Unable to lock streaming texture! SDL Error: %s\n", SDL_GetError() );
+	}
+
+	if( formattedSurface != surface )
+	{
+		SDL_FreeSurface( formattedSurface );
+	}
+	return success;
+}
+
 void LTexture::free()
 {
+	//Free the streaming ring, the current texture is part of it
+	if( mStreamBuffers > 0 )
+	{
+		for( int i = 0; i < mStreamBuffers; ++i )
+		{
+			SDL_DestroyTexture( mStreamTextures[ i ] );
+			mStreamTextures[ i ] = NULL;
+		}
+		mStreamBuffers = 0;
+		mStreamIndex = 0;
+		mStreamWidth = 0;
+		mStreamHeight = 0;
+		mTexture = NULL;
+		mWidth = 0;
+		mHeight = 0;
+	}
+
 	//Free texture if it exists
 	if( mTexture != NULL )
 	{
@@ -218,23 +377,72 @@ void LTexture::free()
 void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue )
 {
 	//Modulate texture rgb
-	SDL_SetTextureColorMod( mTexture, red, green, blue );
+	mRed = red;
+	mGreen = green;
+	mBlue = blue;
+	if( mStreamBuffers > 0 )
+	{
+		for( int i = 0; i < mStreamBuffers; ++i )
+		{
+			SDL_SetTextureColorMod( mStreamTextures[ i ], red, green, blue );
+		}
+	}
+	else
+	{
+		SDL_SetTextureColorMod( mTexture, red, green, blue );
+	}
 }
 
 void LTexture::setBlendMode( SDL_BlendMode blending )
 {
 	//Set blending function
-	SDL_SetTextureBlendMode( mTexture, blending );
+	mBlendMode = blending;
+	if( mStreamBuffers > 0 )
+	{
+		for( int i = 0; i < mStreamBuffers; ++i )
+		{
+			SDL_SetTextureBlendMode( mStreamTextures[ i ], blending );
+		}
+	}
+	else
+	{
+		SDL_SetTextureBlendMode( mTexture, blending );
+	}
 }
 		
 void LTexture::setAlpha( Uint8 alpha )
 {
 	//Modulate texture alpha
-	SDL_SetTextureAlphaMod( mTexture, alpha );
+	mAlpha = alpha;
+	if( mStreamBuffers > 0 )
+	{
+		for( int i = 0; i < mStreamBuffers; ++i )
+		{
+			SDL_SetTextureAlphaMod( mStreamTextures[ i ], alpha );
+		}
+	}
+	else
+	{
+		SDL_SetTextureAlphaMod( mTexture, alpha );
+	}
+}
+
+void LTexture::applyState( SDL_Texture* texture )
+{
+	SDL_SetTextureColorMod( texture, mRed, mGreen, mBlue );
+	SDL_SetTextureAlphaMod( texture, mAlpha );
+	SDL_SetTextureBlendMode( texture, mBlendMode );
 }
 
 void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip )
 {
+	//Streaming textures are only filled up to the current size
+	SDL_Rect streamClip = { 0, 0, mWidth, mHeight };
+	if( clip == NULL && mStreamBuffers > 0 )
+	{
+		clip = &streamClip;
+	}
+
 	//Set rendering space and render to screen
 	SDL_Rect renderQuad = { x, y, mWidth, mHeight };
 
@@ -434,6 +642,12 @@ bool loadMedia()
 		printf( "Failed to load lazy font! SDL_ttf Error: %s\n", TTF_GetError() );
 		success = false;
 	}
+	//The FPS text changes every frame so stream it through a ring of textures
+	else if( !gFPSTextTexture.createStreaming( SCREEN_WIDTH, TTF_FontHeight( gFont ), MAX_STREAM_BUFFERS ) )
+	{
+		printf( "Failed to create FPS texture!\n" );
+		success = false;
+	}
 
 	return success;
 }
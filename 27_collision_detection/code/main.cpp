@@ -5,6 +5,11 @@
 #include <stdio.h>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <deque>
+#include <cmath>
+#include <algorithm>
+#include <stdlib.h>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -12,6 +17,40 @@ const int SCREEN_HEIGHT = 480;
 const int SCREEN_FPS = 60;
 const int SCREEN_TICKS_PER_FRAME = 1000 / SCREEN_FPS;
 
+//Number of dots wandering around besides the player's
+const int TOTAL_DOTS = 100;
+
+//Jobs dealt to each thread so stealing can even out the load
+const int JOBS_PER_THREAD = 4;
+
+//Fewest entities worth handing to another thread
+const int MIN_ENTITIES_PER_JOB = 16;
+
+//The level's wall layout
+const int LEVEL_WALL_X = 300;
+const int PILLAR_SIZE = 8;
+const int PILLAR_SPACING = 40;
+
+//Most walls kept in a single tree leaf
+const int WALLS_PER_LEAF = 4;
+
+//Saved wall tree identifier, "WTRE" in file byte order, and layout version
+const Uint32 WALL_TREE_MAGIC = 0x45525457;
+const Uint32 WALL_TREE_VERSION = 2;
+
+//Deepest wall tree a query's node stack can walk
+const int WALL_TREE_MAX_DEPTH = 63;
+
+//Side of the broad phase cells marked when a wall overlaps them, at least a dot plus a frame's move
+const int WALL_CELL_SIZE = 32;
+
+//Most broad phase cells kept before every move takes the exact path instead
+const int WALL_CELL_MAX = 1 << 20;
+
+//Scaling benchmark workload
+const int BENCHMARK_DOTS = 100000;
+const int BENCHMARK_FRAMES = 200;
+
 //Texture wrapper class
 class LTexture
 {
@@ -90,38 +129,207 @@ class LTimer
 		bool mStarted;
 };
 
-//The dot that will move around on the screen
-class Dot
+//Entity identifier, an index into the component pools
+typedef int Entity;
+
+//Entity component store, every component lives in its own dense array
+class EntityStore
 {
 	public:
-		//The dimensions of the dot
+		//The dimensions of a dot
 		static const int DOT_WIDTH = 20;
 		static const int DOT_HEIGHT = 20;
 		
-		//Maximum axis velocity of the dot
+		//Maximum axis velocity of a dot
 		static const int DOT_VEL = 10;
 		
 		//Initializes the variables
-		Dot();
+		EntityStore();
+		
+		//Reserves room in every pool so creating entities doesn't reallocate
+		void reserve(int capacity);
+		
+		//Creates an entity and returns its identifier
+		Entity create(int x, int y, int vx, int vy, LTexture* texture, bool bounces);
+		
+		//Removes every entity
+		void clear();
+		
+		//Gets the number of entities
+		int getSize();
+		
+		//Position components
+		std::vector<int> posX, posY;
+		
+		//Velocity components
+		std::vector<int> velX, velY;
+		
+		//Collision box components, anchored at the position
+		std::vector<int> colliderW, colliderH;
+		
+		//Whether the entity turns around when blocked instead of stopping
+		std::vector<Uint8> bounce;
+		
+		//Broad phase flag, set when the entity's move this frame may reach a wall
+		std::vector<Uint8> nearWall;
+		
+		//Sprite components
+		std::vector<LTexture*> sprite;
+		
+	private:
+		//The number of entities
+		int mSize;
+};
+
+//A unit of work covering a range of entities
+struct Job
+{
+	//Function run over the range
+	void (*function)(void* data, int begin, int end);
+	
+	//Data passed to the function
+	void* data;
+	
+	//The range of entities
+	int begin, end;
+};
+
+//Work stealing job system with a fixed pool of worker threads
+class JobSystem
+{
+	public:
+		//Initializes variables
+		JobSystem();
+		
+		//Stops the workers
+		~JobSystem();
 		
-		//Takes key presses and adjusts the dot's velocity
-		void handleEvent(SDL_Event& e);
+		//Starts the workers, the calling thread counts as one of the threads
+		bool init(int threads);
 		
-		//Moves the dot
-		void move(SDL_Rect& wall);
+		//Stops the workers and frees the queues
+		void free();
+		
+		//Runs function over [0, count) in ranges of at most grain entities
+		//across every thread and returns once all of them are done
+		void parallelFor(int count, int grain, void (*function)(void* data, int begin, int end), void* data);
 		
-		//Shows the dot on the scren
-		void render();
+		//Gets the number of threads, including the calling one
+		int getThreadCount();
 		
 	private:
-		//The X and Y offsets of the dot
-		int mPosX, mPosY;
+		//Per thread job queue
+		struct Worker
+		{
+			//The job system the worker belongs to
+			JobSystem* system;
+			
+			//The worker's index, queue 0 belongs to the calling thread
+			int index;
+			
+			//The worker's thread
+			SDL_Thread* thread;
+			
+			//Guards the job queue
+			SDL_mutex* mutex;
+			
+			//The owner pops from the back, thieves steal from the front
+			std::deque<Job> jobs;
+		};
+		
+		//Worker thread entry point
+		static int workerMain(void* data);
+		
+		//Runs one job from the thread's own queue or steals one,
+		//returns false if every queue was empty
+		bool runJob(int index);
+		
+		//The workers
+		Worker* mWorkers;
+		int mThreadCount;
+		
+		//Jobs pushed but not finished yet
+		SDL_atomic_t mPending;
 		
-		//The velocity of the dot
-		int mVelX, mVelY;
+		//Wakes sleeping workers when jobs are pushed
+		SDL_mutex* mWakeMutex;
+		SDL_cond* mWakeCond;
 		
-		//Dot's collision box
-		SDL_Rect mCollider;
+		//Bumped every time jobs are pushed
+		int mGeneration;
+		
+		//Stop flag for the workers
+		bool mQuit;
+};
+
+//Bounding volume hierarchy over the level's static walls
+class WallTree
+{
+	public:
+		//Initializes variables
+		WallTree();
+		
+		//Builds the tree over the walls
+		void build(std::vector<SDL_Rect>& walls);
+		
+		//Saves the built tree so it doesn't need rebuilding, tagged with the level it was built from
+		bool saveToFile(std::string path, Uint32 levelHash);
+		
+		//Loads a tree saved with saveToFile, false if it is damaged or was built from another level
+		bool loadFromFile(std::string path, Uint32 levelHash);
+		
+		//Hashes a wall layout so saved trees can tell which level they belong to
+		static Uint32 hashWalls(std::vector<SDL_Rect>& walls);
+		
+		//Deallocates the tree
+		void free();
+		
+		//Collects the walls overlapping the area
+		void query(SDL_Rect& area, std::vector<int>& hits);
+		
+		//Flags the entities in [begin, end) whose move this frame may reach a wall
+		void flagNearWalls(EntityStore& store, int begin, int end);
+		
+		//Gets a wall by index
+		SDL_Rect& getWall(int index);
+		
+		//Gets the number of walls
+		int getWallCount();
+		
+	private:
+		//A tree node, stored depth first so the left child follows its parent
+		struct Node
+		{
+			//Box around everything below the node
+			SDL_Rect bounds;
+			
+			//Leaves cover walls [first, first + count), inner nodes have no walls
+			Sint32 first;
+			Sint32 count;
+			
+			//Index of the right child of an inner node
+			Sint32 right;
+		};
+		
+		//Builds the node over walls [begin, end) and returns its index
+		int buildNode(int begin, int end);
+		
+		//Checks every node index and wall range and the depth of a loaded tree
+		bool validate();
+		
+		//Marks every broad phase cell a wall overlaps
+		void buildCells();
+		
+		//The nodes, root first
+		std::vector<Node> mNodes;
+		
+		//The walls, reordered so every leaf covers a contiguous range
+		std::vector<SDL_Rect> mWalls;
+		
+		//Broad phase cells over the box around every wall, nonzero where a wall overlaps
+		std::vector<Uint8> mCells;
+		int mCellsX, mCellsY;
+		int mCellsAcross, mCellsDown;
 };
 
 //Starts up SDL and creates window
@@ -136,6 +344,34 @@ void close();
 //Box collision detector
 bool checkCollision(SDL_Rect a, SDL_Rect b);
 
+//Box/Box sweep, finds when box a moving by (velX, velY) first overlaps box b
+//Gets the fraction of the move made before contact and whether a side or the top/bottom was hit
+bool sweepCollision(SDL_Rect a, int velX, int velY, SDL_Rect b, float& time, bool& hitX);
+
+//Takes key presses and adjusts the entity's velocity
+void handleInput(EntityStore& store, Entity entity, SDL_Event& e);
+
+//Lays out the level's walls
+void createLevel(std::vector<SDL_Rect>& walls);
+
+//Creates dots with random velocities left of the level's big wall
+void spawnDots(EntityStore& store, int count);
+
+//Moves the entities in [begin, end), keeping them out of the walls
+void moveSystem(EntityStore& store, WallTree& walls, int begin, int end);
+
+//Moves one entity up to the first wall it hits and slides it along that wall with the rest of the move
+void sweepEntity(EntityStore& store, WallTree& walls, Entity entity, std::vector<int>& nearby);
+
+//Moves every entity across all of the job system's threads
+void moveSystem(JobSystem& jobs, EntityStore& store, WallTree& walls);
+
+//Times the move and collision phases at 1, 2, 4, 8 and 16 threads
+void runScalingBenchmark();
+
+//Shows every entity on the screen
+void renderSystem(EntityStore& store);
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -148,6 +384,9 @@ SDL_Renderer* gRenderer = NULL;
 //Scene textures
 LTexture gDotTexture;
 
+//The level's walls
+WallTree gWalls;
+
 LTexture::LTexture()
 {
 	//Initialize
@@ -398,22 +637,120 @@ bool LTimer::isPaused()
     return mPaused && mStarted;
 }
 
-Dot::Dot()
+EntityStore::EntityStore()
 {
-	//Initializes the offsets
-	mPosX = 0;
-	mPosY = 0;
+	//Initialize the entity count
+	mSize = 0;
+}
+
+void EntityStore::reserve(int capacity)
+{
+	posX.reserve(capacity);
+	posY.reserve(capacity);
+	velX.reserve(capacity);
+	velY.reserve(capacity);
+	colliderW.reserve(capacity);
+	colliderH.reserve(capacity);
+	bounce.reserve(capacity);
+	nearWall.reserve(capacity);
+	sprite.reserve(capacity);
+}
+
+Entity EntityStore::create(int x, int y, int vx, int vy, LTexture* texture, bool bounces)
+{
+	//Append the components at the end of every pool
+	posX.push_back(x);
+	posY.push_back(y);
+	velX.push_back(vx);
+	velY.push_back(vy);
+	colliderW.push_back((int)DOT_WIDTH);
+	colliderH.push_back((int)DOT_HEIGHT);
+	bounce.push_back(bounces ? 1 : 0);
+	nearWall.push_back(0);
+	sprite.push_back(texture);
+	
+	return mSize++;
+}
+
+void EntityStore::clear()
+{
+	posX.clear();
+	posY.clear();
+	velX.clear();
+	velY.clear();
+	colliderW.clear();
+	colliderH.clear();
+	bounce.clear();
+	nearWall.clear();
+	sprite.clear();
+	mSize = 0;
+}
+
+int EntityStore::getSize()
+{
+	return mSize;
+}
+
+bool sweepCollision(SDL_Rect a, int velX, int velY, SDL_Rect b, float& time, bool& hitX)
+{
+	//When the boxes start and stop overlapping along each axis
+	float entryX, exitX, entryY, exitY;
+	if(velX > 0)
+	{
+		entryX = (float)(b.x - (a.x + a.w)) / velX;
+		exitX = (float)(b.x + b.w - a.x) / velX;
+	}
+	else if(velX < 0)
+	{
+		entryX = (float)(b.x + b.w - a.x) / velX;
+		exitX = (float)(b.x - (a.x + a.w)) / velX;
+	}
+	else if(a.x + a.w <= b.x || a.x >= b.x + b.w)
+	{
+		return false;
+	}
+	else
+	{
+		entryX = -HUGE_VALF;
+		exitX = HUGE_VALF;
+	}
+	
+	if(velY > 0)
+	{
+		entryY = (float)(b.y - (a.y + a.h)) / velY;
+		exitY = (float)(b.y + b.h - a.y) / velY;
+	}
+	else if(velY < 0)
+	{
+		entryY = (float)(b.y + b.h - a.y) / velY;
+		exitY = (float)(b.y - (a.y + a.h)) / velY;
+	}
+	else if(a.y + a.h <= b.y || a.y >= b.y + b.h)
+	{
+		return false;
+	}
+	else
+	{
+		entryY = -HUGE_VALF;
+		exitY = HUGE_VALF;
+	}
 	
-	//Set collision box dimension
-	mCollider.w = DOT_WIDTH;
-	mCollider.h = DOT_HEIGHT;
+	//The boxes have to overlap along both axes at once during the move,
+	//touching without overlapping doesn't count
+	float entry = entryX > entryY ? entryX : entryY;
+	float exit = exitX < exitY ? exitX : exitY;
+	if(entry >= exit || entry < 0.f || entry >= 1.f)
+	{
+		return false;
+	}
 	
-	//Initialize the velocity
-	mVelX = 0;
-	mVelY = 0;
+	//The axis that started overlapping last is the one hit
+	time = entry;
+	hitX = entryX >= entryY;
+	return true;
 }
 
-void Dot::handleEvent(SDL_Event& e)
+void handleInput(EntityStore& store, Entity entity, SDL_Event& e)
 {
 	//If a key was pressed
 	if(e.type == SDL_KEYDOWN && e.key.repeat == 0)
@@ -421,10 +758,10 @@ void Dot::handleEvent(SDL_Event& e)
 		//Adjust the velocity
 		switch(e.key.keysym.sym)
 		{
-			case SDLK_UP: mVelY -= DOT_VEL; break;
-			case SDLK_DOWN: mVelY += DOT_VEL; break;
-			case SDLK_LEFT: mVelX -= DOT_VEL; break;
-			case SDLK_RIGHT: mVelX += DOT_VEL; break;
+			case SDLK_UP: store.velY[entity] -= EntityStore::DOT_VEL; break;
+			case SDLK_DOWN: store.velY[entity] += EntityStore::DOT_VEL; break;
+			case SDLK_LEFT: store.velX[entity] -= EntityStore::DOT_VEL; break;
+			case SDLK_RIGHT: store.velX[entity] += EntityStore::DOT_VEL; break;
 		}
 	}
 	//If a key was released
@@ -433,47 +770,868 @@ void Dot::handleEvent(SDL_Event& e)
 		//Adjust the velocity
 		switch(e.key.keysym.sym)
 		{
-			case SDLK_UP: mVelY += DOT_VEL; break;
-			case SDLK_DOWN: mVelY -= DOT_VEL; break;
-			case SDLK_LEFT: mVelX += DOT_VEL; break;
-			case SDLK_RIGHT: mVelX -= DOT_VEL; break;
+			case SDLK_UP: store.velY[entity] += EntityStore::DOT_VEL; break;
+			case SDLK_DOWN: store.velY[entity] -= EntityStore::DOT_VEL; break;
+			case SDLK_LEFT: store.velX[entity] += EntityStore::DOT_VEL; break;
+			case SDLK_RIGHT: store.velX[entity] -= EntityStore::DOT_VEL; break;
 		}
 	}
 }
 
-void Dot::move(SDL_Rect &wall)
+void createLevel(std::vector<SDL_Rect>& walls)
+{
+	walls.clear();
+	
+	//The edges of the screen, so entities sweep against them like any other wall
+	SDL_Rect left = {-SCREEN_WIDTH, -SCREEN_HEIGHT, SCREEN_WIDTH, 3 * SCREEN_HEIGHT};
+	SDL_Rect right = {SCREEN_WIDTH, -SCREEN_HEIGHT, SCREEN_WIDTH, 3 * SCREEN_HEIGHT};
+	SDL_Rect top = {0, -SCREEN_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT};
+	SDL_Rect bottom = {0, SCREEN_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT};
+	walls.push_back(left);
+	walls.push_back(right);
+	walls.push_back(top);
+	walls.push_back(bottom);
+	
+	//The big wall
+	SDL_Rect wall = {LEVEL_WALL_X, 40, 40, 400};
+	walls.push_back(wall);
+	
+	//A field of pillars right of it
+	for(int y = PILLAR_SPACING / 2; y + PILLAR_SIZE < SCREEN_HEIGHT; y += PILLAR_SPACING)
+	{
+		for(int x = wall.x + wall.w + PILLAR_SPACING; x + PILLAR_SIZE < SCREEN_WIDTH; x += PILLAR_SPACING)
+		{
+			SDL_Rect pillar = {x, y, PILLAR_SIZE, PILLAR_SIZE};
+			walls.push_back(pillar);
+		}
+	}
+}
+
+void spawnDots(EntityStore& store, int count)
+{
+	for(int i = 0; i < count; ++i)
+	{
+		int x = rand() % (LEVEL_WALL_X - EntityStore::DOT_WIDTH);
+		int y = rand() % (SCREEN_HEIGHT - EntityStore::DOT_HEIGHT);
+		int velX = rand() % (2 * EntityStore::DOT_VEL + 1) - EntityStore::DOT_VEL;
+		int velY = rand() % (2 * EntityStore::DOT_VEL + 1) - EntityStore::DOT_VEL;
+		store.create(x, y, velX, velY, &gDotTexture, true);
+	}
+}
+
+void moveSystem(EntityStore& store, WallTree& walls, int begin, int end)
 {
-	//Move the dot left or right
-	mPosX += mVelX;
-	mCollider.x = mPosX;
+	//Find the few entities whose move may reach a wall
+	walls.flagNearWalls(store, begin, end);
 	
-	//If the dot went too far to the left or right
-	if((mPosX < 0) || (mPosX + DOT_WIDTH > SCREEN_WIDTH) 
-		|| checkCollision(mCollider, wall))
+	//Raw pools so the loop below is a plain array walk without branches
+	int* posX = store.posX.data();
+	int* posY = store.posY.data();
+	const int* velX = store.velX.data();
+	const int* velY = store.velY.data();
+	const Uint8* nearWall = store.nearWall.data();
+	
+	//Move everything in the open straight away
+	for(int i = begin; i < end; ++i)
 	{
-		//Move back 
-		mPosX -= mVelX;
-		mCollider.x = mPosX;
+		int open = 1 - nearWall[i];
+		posX[i] += velX[i] * open;
+		posY[i] += velY[i] * open;
 	}
 	
-	//Move the dot up or down
-	mPosY += mVelY;
-	mCollider.y = mPosY;
+	//Sweep the rest against the walls around them
+	std::vector<int> nearby;
+	for(int i = begin; i < end; ++i)
+	{
+		if(nearWall[i])
+		{
+			sweepEntity(store, walls, i, nearby);
+		}
+	}
+}
+
+void sweepEntity(EntityStore& store, WallTree& walls, Entity entity, std::vector<int>& nearby)
+{
+	//The entity's collision box and how far it still has to go this frame
+	SDL_Rect box = { store.posX[entity], store.posY[entity], store.colliderW[entity], store.colliderH[entity] };
+	int moveX = store.velX[entity];
+	int moveY = store.velY[entity];
 	
-	//If the dot went too far up or down
-	if((mPosY < 0) || (mPosY + DOT_HEIGHT > SCREEN_HEIGHT)
-		|| checkCollision(mCollider, wall))
+	//Move up to the first wall hit, then slide along it with the rest of the move
+	for(int pass = 0; pass < 2 && (moveX != 0 || moveY != 0); ++pass)
 	{
-		//Move back
-		mPosY -= mVelY;
-		mCollider.y = mPosY;
+		//Only the walls inside the area swept by the box can be hit
+		SDL_Rect swept = box;
+		swept.x = moveX < 0 ? box.x + moveX : box.x;
+		swept.y = moveY < 0 ? box.y + moveY : box.y;
+		swept.w = box.w + (moveX < 0 ? -moveX : moveX);
+		swept.h = box.h + (moveY < 0 ? -moveY : moveY);
+		walls.query(swept, nearby);
+		
+		//Find the earliest hit
+		float time = 1.f;
+		bool hitX = false;
+		int hitWall = -1;
+		for(int j = 0; j < (int)nearby.size(); ++j)
+		{
+			float wallTime;
+			bool wallHitX;
+			if(sweepCollision(box, moveX, moveY, walls.getWall(nearby[j]), wallTime, wallHitX) && wallTime < time)
+			{
+				time = wallTime;
+				hitX = wallHitX;
+				hitWall = nearby[j];
+			}
+		}
+		
+		if(hitWall < 0)
+		{
+			box.x += moveX;
+			box.y += moveY;
+			break;
+		}
+		
+		SDL_Rect& wall = walls.getWall(hitWall);
+		if(hitX)
+		{
+			//Touch the side of the wall and keep what's left of the vertical move
+			int stepY = (int)(moveY * time);
+			box.x = moveX > 0 ? wall.x - box.w : wall.x + wall.w;
+			box.y += stepY;
+			moveX = 0;
+			moveY -= stepY;
+			
+			if(store.bounce[entity])
+			{
+				store.velX[entity] = -store.velX[entity];
+			}
+		}
+		else
+		{
+			//Touch the top or bottom of the wall and keep what's left of the horizontal move
+			int stepX = (int)(moveX * time);
+			box.y = moveY > 0 ? wall.y - box.h : wall.y + wall.h;
+			box.x += stepX;
+			moveX -= stepX;
+			moveY = 0;
+			
+			if(store.bounce[entity])
+			{
+				store.velY[entity] = -store.velY[entity];
+			}
+		}
 	}
+	
+	store.posX[entity] = box.x;
+	store.posY[entity] = box.y;
 }
 
-void Dot::render()
+//What a move job works on
+struct MoveJobData
+{
+	EntityStore* store;
+	WallTree* walls;
+};
+
+//Job function moving a range of entities
+void moveJob(void* data, int begin, int end)
 {
-	//Show the dot
-	gDotTexture.render(mPosX, mPosY);
+	MoveJobData* move = (MoveJobData*)data;
+	moveSystem(*move->store, *move->walls, begin, end);
+}
+
+void moveSystem(JobSystem& jobs, EntityStore& store, WallTree& walls)
+{
+	//Entities only collide with the screen and the static walls, so ranges are independent
+	MoveJobData data = { &store, &walls };
+	
+	//A few jobs per thread, so even the small live scene is split
+	int grain = store.getSize() / (SDL_max(jobs.getThreadCount(), 1) * JOBS_PER_THREAD);
+	jobs.parallelFor(store.getSize(), SDL_max(grain, MIN_ENTITIES_PER_JOB), moveJob, &data);
+}
+
+void runScalingBenchmark()
+{
+	//The benchmark scene
+	EntityStore store;
+	store.reserve(BENCHMARK_DOTS);
+	spawnDots(store, BENCHMARK_DOTS);
+	
+	//The thread counts to try
+	const int threadCounts[] = { 1, 2, 4, 8, 16 };
+	const int totalCounts = sizeof(threadCounts) / sizeof(threadCounts[0]);
+	double singleThreadTime = 0.0;
+	std::stringstream caption;
+	caption << "Move+collide " << BENCHMARK_DOTS << " dots:";
+	
+	for(int i = 0; i < totalCounts; ++i)
+	{
+		JobSystem jobs;
+		if(!jobs.init(threadCounts[i]))
+		{
+			printf("Unable to start %d threads!\n", threadCounts[i]);
+			continue;
+		}
+		
+		//Warm up the caches and the workers
+		for(int frame = 0; frame < 10; ++frame)
+		{
+			moveSystem(jobs, store, gWalls);
+		}
+		
+		//Time the frames
+		Uint64 start = SDL_GetPerformanceCounter();
+		for(int frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+		{
+			moveSystem(jobs, store, gWalls);
+		}
+		Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+		double frameTime = 1000.0 * elapsed / SDL_GetPerformanceFrequency() / BENCHMARK_FRAMES;
+		if(i == 0)
+		{
+			singleThreadTime = frameTime;
+		}
+		
+		printf("%2d threads: %.3f ms per frame, %.2fx speedup\n", threadCounts[i], frameTime, singleThreadTime / frameTime);
+		caption << " " << threadCounts[i] << "T=" << frameTime << "ms";
+		
+		jobs.free();
+	}
+	
+	//Show the results where a windowed build can see them
+	SDL_SetWindowTitle(gWindow, caption.str().c_str());
+}
+
+void renderSystem(EntityStore& store)
+{
+	//Show every entity's sprite at its position
+	int count = store.getSize();
+	for(int i = 0; i < count; ++i)
+	{
+		store.sprite[i]->render(store.posX[i], store.posY[i]);
+	}
+}
+
+WallTree::WallTree()
+{
+	//Initialize the broad phase grid
+	mCellsX = 0;
+	mCellsY = 0;
+	mCellsAcross = 0;
+	mCellsDown = 0;
+}
+
+void WallTree::build(std::vector<SDL_Rect>& walls)
+{
+	//Get rid of the preexisting tree
+	free();
+	
+	mWalls = walls;
+	if(!mWalls.empty())
+	{
+		mNodes.reserve(2 * mWalls.size() / WALLS_PER_LEAF + 1);
+		buildNode(0, (int)mWalls.size());
+	}
+	buildCells();
+}
+
+//Orders walls by their center along one axis
+struct WallCenterLess
+{
+	bool alongX;
+	
+	bool operator()(const SDL_Rect& a, const SDL_Rect& b) const
+	{
+		return alongX ? 2 * a.x + a.w < 2 * b.x + b.w : 2 * a.y + a.h < 2 * b.y + b.h;
+	}
+};
+
+int WallTree::buildNode(int begin, int end)
+{
+	//Box around every wall in the range
+	int left = mWalls[begin].x;
+	int top = mWalls[begin].y;
+	int right = mWalls[begin].x + mWalls[begin].w;
+	int bottom = mWalls[begin].y + mWalls[begin].h;
+	for(int i = begin + 1; i < end; ++i)
+	{
+		left = std::min(left, mWalls[i].x);
+		top = std::min(top, mWalls[i].y);
+		right = std::max(right, mWalls[i].x + mWalls[i].w);
+		bottom = std::max(bottom, mWalls[i].y + mWalls[i].h);
+	}
+	
+	int index = (int)mNodes.size();
+	Node node;
+	node.bounds.x = left;
+	node.bounds.y = top;
+	node.bounds.w = right - left;
+	node.bounds.h = bottom - top;
+	node.first = begin;
+	node.count = end - begin;
+	node.right = -1;
+	mNodes.push_back(node);
+	
+	//Few enough walls for a leaf
+	if(end - begin <= WALLS_PER_LEAF)
+	{
+		return index;
+	}
+	
+	//Split at the median along the longer side
+	int middle = (begin + end) / 2;
+	WallCenterLess less = { right - left >= bottom - top };
+	std::nth_element(mWalls.begin() + begin, mWalls.begin() + middle, mWalls.begin() + end, less);
+	
+	//The left child is built right after its parent
+	buildNode(begin, middle);
+	int rightChild = buildNode(middle, end);
+	
+	mNodes[index].count = 0;
+	mNodes[index].right = rightChild;
+	return index;
+}
+
+bool WallTree::saveToFile(std::string path, Uint32 levelHash)
+{
+	SDL_RWops* file = SDL_RWFromFile(path.c_str(), "w+b");
+	if(file == NULL)
+	{
+		printf("Unable to save wall tree %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+		return false;
+	}
+	
+	//Header first, then the raw arrays
+	Uint32 header[3] = {WALL_TREE_MAGIC, WALL_TREE_VERSION, levelHash};
+	Sint32 nodeCount = (Sint32)mNodes.size();
+	Sint32 wallCount = (Sint32)mWalls.size();
+	bool success = SDL_RWwrite(file, header, sizeof(Uint32), 3) == 3
+		&& SDL_RWwrite(file, &nodeCount, sizeof(Sint32), 1) == 1
+		&& SDL_RWwrite(file, &wallCount, sizeof(Sint32), 1) == 1;
+	if(success && nodeCount > 0)
+	{
+		success = SDL_RWwrite(file, &mNodes[0], sizeof(Node), nodeCount) == (size_t)nodeCount;
+	}
+	if(success && wallCount > 0)
+	{
+		success = SDL_RWwrite(file, &mWalls[0], sizeof(SDL_Rect), wallCount) == (size_t)wallCount;
+	}
+	if(!success)
+	{
+		printf("Unable to write wall tree %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+	}
+	
+	SDL_RWclose(file);
+	return success;
+}
+
+bool WallTree::loadFromFile(std::string path, Uint32 levelHash)
+{
+	//Get rid of the preexisting tree
+	free();
+	
+	SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+	if(file == NULL)
+	{
+		return false;
+	}
+	
+	//Only trees this version built from this level are used
+	Uint32 header[3] = {0, 0, 0};
+	if(SDL_RWread(file, header, sizeof(Uint32), 3) != 3 || header[0] != WALL_TREE_MAGIC 
+		|| header[1] != WALL_TREE_VERSION || header[2] != levelHash)
+	{
+		printf("Wall tree %s is out of date, rebuilding it\n", path.c_str());
+		SDL_RWclose(file);
+		return false;
+	}
+	
+	//Read the counts and make sure the file holds that many
+	Sint32 nodeCount = 0;
+	Sint32 wallCount = 0;
+	Sint64 size = SDL_RWsize(file);
+	bool success = SDL_RWread(file, &nodeCount, sizeof(Sint32), 1) == 1
+		&& SDL_RWread(file, &wallCount, sizeof(Sint32), 1) == 1
+		&& nodeCount > 0 && wallCount > 0
+		&& size == 5 * (Sint64)sizeof(Sint32) + (Sint64)nodeCount * (Sint64)sizeof(Node) + (Sint64)wallCount * (Sint64)sizeof(SDL_Rect);
+	if(success)
+	{
+		mNodes.resize(nodeCount);
+		mWalls.resize(wallCount);
+		success = SDL_RWread(file, &mNodes[0], sizeof(Node), nodeCount) == (size_t)nodeCount
+			&& SDL_RWread(file, &mWalls[0], sizeof(SDL_Rect), wallCount) == (size_t)wallCount
+			&& validate();
+	}
+	
+	SDL_RWclose(file);
+	
+	if(success)
+	{
+		buildCells();
+	}
+	else
+	{
+		printf("Wall tree %s is damaged, rebuilding it\n", path.c_str());
+		free();
+	}
+	
+	return success;
+}
+
+bool WallTree::validate()
+{
+	int nodeCount = (int)mNodes.size();
+	int wallCount = (int)mWalls.size();
+	
+	//Children always come after their parent, so depths fill in front to back
+	std::vector<int> depth(nodeCount, 0);
+	for(int i = 0; i < nodeCount; ++i)
+	{
+		Node& node = mNodes[i];
+		if(node.count > 0)
+		{
+			//Leaves cover a range inside the walls
+			if(node.first < 0 || node.count > wallCount || node.first > wallCount - node.count)
+			{
+				return false;
+			}
+		}
+		else
+		{
+			//Inner nodes have both children after them and inside the tree
+			if(node.count < 0 || i + 1 >= nodeCount || node.right <= i + 1 || node.right >= nodeCount)
+			{
+				return false;
+			}
+			
+			//Keep queries inside their node stack
+			if(depth[i] + 1 > WALL_TREE_MAX_DEPTH)
+			{
+				return false;
+			}
+			depth[i + 1] = std::max(depth[i + 1], depth[i] + 1);
+			depth[node.right] = std::max(depth[node.right], depth[i] + 1);
+		}
+	}
+	
+	return true;
+}
+
+Uint32 WallTree::hashWalls(std::vector<SDL_Rect>& walls)
+{
+	//FNV-1a over every coordinate
+	Uint32 hash = 2166136261u;
+	for(size_t i = 0; i < walls.size(); ++i)
+	{
+		Sint32 values[4] = {walls[i].x, walls[i].y, walls[i].w, walls[i].h};
+		for(int j = 0; j < 4; ++j)
+		{
+			hash = (hash ^ (Uint32)values[j]) * 16777619u;
+		}
+	}
+	
+	return hash;
+}
+
+void WallTree::free()
+{
+	mNodes.clear();
+	mWalls.clear();
+	mCells.clear();
+	mCellsAcross = 0;
+	mCellsDown = 0;
+}
+
+void WallTree::buildCells()
+{
+	mCells.clear();
+	if(mWalls.empty())
+	{
+		return;
+	}
+	
+	//Box around every wall
+	int left = mWalls[0].x;
+	int top = mWalls[0].y;
+	int right = mWalls[0].x + mWalls[0].w;
+	int bottom = mWalls[0].y + mWalls[0].h;
+	for(int i = 1; i < (int)mWalls.size(); ++i)
+	{
+		left = SDL_min(left, mWalls[i].x);
+		top = SDL_min(top, mWalls[i].y);
+		right = SDL_max(right, mWalls[i].x + mWalls[i].w);
+		bottom = SDL_max(bottom, mWalls[i].y + mWalls[i].h);
+	}
+	
+	//Levels too big for the grid leave it empty so every move is swept
+	Sint64 across = ((Sint64)right - left + WALL_CELL_SIZE - 1) / WALL_CELL_SIZE;
+	Sint64 down = ((Sint64)bottom - top + WALL_CELL_SIZE - 1) / WALL_CELL_SIZE;
+	if(across <= 0 || down <= 0 || across * down > WALL_CELL_MAX)
+	{
+		return;
+	}
+	mCellsX = left;
+	mCellsY = top;
+	mCellsAcross = (int)across;
+	mCellsDown = (int)down;
+	mCells.assign(mCellsAcross * mCellsDown, 0);
+	
+	//Mark the cells under every wall
+	for(int i = 0; i < (int)mWalls.size(); ++i)
+	{
+		SDL_Rect& wall = mWalls[i];
+		if(wall.w <= 0 || wall.h <= 0)
+		{
+			continue;
+		}
+		int x1 = (wall.x - left) / WALL_CELL_SIZE;
+		int y1 = (wall.y - top) / WALL_CELL_SIZE;
+		int x2 = (wall.x + wall.w - 1 - left) / WALL_CELL_SIZE;
+		int y2 = (wall.y + wall.h - 1 - top) / WALL_CELL_SIZE;
+		for(int y = y1; y <= y2; ++y)
+		{
+			std::fill(mCells.begin() + y * mCellsAcross + x1, mCells.begin() + y * mCellsAcross + x2 + 1, (Uint8)1);
+		}
+	}
+}
+
+void WallTree::flagNearWalls(EntityStore& store, int begin, int end)
+{
+	Uint8* nearWall = store.nearWall.data();
+	
+	//Without a grid every move is swept, unless there is nothing to hit
+	if(mCells.empty())
+	{
+		std::fill(nearWall + begin, nearWall + end, (Uint8)(mWalls.empty() ? 0 : 1));
+		return;
+	}
+	
+	//Raw pools so the loop below is a plain array walk without branches
+	const int* posX = store.posX.data();
+	const int* posY = store.posY.data();
+	const int* velX = store.velX.data();
+	const int* velY = store.velY.data();
+	const int* colliderW = store.colliderW.data();
+	const int* colliderH = store.colliderH.data();
+	const Uint8* cells = mCells.data();
+	const int gridLeft = mCellsX;
+	const int gridTop = mCellsY;
+	const int gridRight = mCellsX + mCellsAcross * WALL_CELL_SIZE;
+	const int gridBottom = mCellsY + mCellsDown * WALL_CELL_SIZE;
+	const int across = mCellsAcross;
+	const int lastX = mCellsAcross - 1;
+	const int lastY = mCellsDown - 1;
+	
+	for(int i = begin; i < end; ++i)
+	{
+		//The box swept by this frame's move, inclusive
+		int left = SDL_min(posX[i], posX[i] + velX[i]);
+		int top = SDL_min(posY[i], posY[i] + velY[i]);
+		int right = SDL_max(posX[i], posX[i] + velX[i]) + colliderW[i] - 1;
+		int bottom = SDL_max(posY[i], posY[i] + velY[i]) + colliderH[i] - 1;
+		
+		//A box no bigger than a cell only touches the cells under its corners
+		int x1 = SDL_min(SDL_max((left - gridLeft) / WALL_CELL_SIZE, 0), lastX);
+		int y1 = SDL_min(SDL_max((top - gridTop) / WALL_CELL_SIZE, 0), lastY);
+		int x2 = SDL_min(SDL_max((right - gridLeft) / WALL_CELL_SIZE, 0), lastX);
+		int y2 = SDL_min(SDL_max((bottom - gridTop) / WALL_CELL_SIZE, 0), lastY);
+		int corners = cells[y1 * across + x1] | cells[y1 * across + x2] | cells[y2 * across + x1] | cells[y2 * across + x2];
+		
+		//Bigger boxes and boxes leaving the grid always take the exact path
+		int large = (right - left >= WALL_CELL_SIZE) | (bottom - top >= WALL_CELL_SIZE);
+		int outside = (left < gridLeft) | (top < gridTop) | (right >= gridRight) | (bottom >= gridBottom);
+		nearWall[i] = (Uint8)(corners | large | outside);
+	}
+}
+
+void WallTree::query(SDL_Rect& area, std::vector<int>& hits)
+{
+	hits.clear();
+	if(mNodes.empty())
+	{
+		return;
+	}
+	
+	//Nodes left to visit, never more than the depth plus one
+	int stack[WALL_TREE_MAX_DEPTH + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	
+	while(stackSize > 0)
+	{
+		int index = stack[--stackSize];
+		Node& node = mNodes[index];
+		if(!checkCollision(area, node.bounds))
+		{
+			continue;
+		}
+		
+		if(node.count > 0)
+		{
+			//Test the leaf's walls
+			for(int i = node.first; i < node.first + node.count; ++i)
+			{
+				if(checkCollision(area, mWalls[i]))
+				{
+					hits.push_back(i);
+				}
+			}
+		}
+		else
+		{
+			//Visit both children
+			stack[stackSize++] = node.right;
+			stack[stackSize++] = index + 1;
+		}
+	}
+}
+
+SDL_Rect& WallTree::getWall(int index)
+{
+	return mWalls[index];
+}
+
+int WallTree::getWallCount()
+{
+	return (int)mWalls.size();
+}
+
+JobSystem::JobSystem()
+{
+	//Initialize
+	mWorkers = NULL;
+	mThreadCount = 0;
+	SDL_AtomicSet(&mPending, 0);
+	mWakeMutex = NULL;
+	mWakeCond = NULL;
+	mGeneration = 0;
+	mQuit = false;
+}
+
+JobSystem::~JobSystem()
+{
+	//Deallocate
+	free();
+}
+
+bool JobSystem::init(int threads)
+{
+	//Get rid of preexisting workers
+	free();
+	
+	if(threads < 1)
+	{
+		threads = 1;
+	}
+	
+	mWakeMutex = SDL_CreateMutex();
+	mWakeCond = SDL_CreateCond();
+	if(mWakeMutex == NULL || mWakeCond == NULL)
+	{
+		printf("Unable to create job system wake signal! SDL Error: %s\n", SDL_GetError());
+		free();
+		return false;
+	}
+	
+	//Set up the queues before any thread can steal from them
+	mWorkers = new Worker[threads];
+	mThreadCount = threads;
+	for(int i = 0; i < mThreadCount; ++i)
+	{
+		mWorkers[i].system = this;
+		mWorkers[i].index = i;
+		mWorkers[i].thread = NULL;
+		mWorkers[i].mutex = SDL_CreateMutex();
+	}
+	
+	bool success = true;
+	for(int i = 0; i < mThreadCount && success; ++i)
+	{
+		if(mWorkers[i].mutex == NULL)
+		{
+			printf("Unable to create job queue lock! SDL Error: %s\n", SDL_GetError());
+			success = false;
+		}
+	}
+	
+	//Start the workers, queue 0 is serviced by the calling thread
+	for(int i = 1; i < mThreadCount && success; ++i)
+	{
+		mWorkers[i].thread = SDL_CreateThread(workerMain, "JobWorker", &mWorkers[i]);
+		if(mWorkers[i].thread == NULL)
+		{
+			printf("Unable to create worker thread! SDL Error: %s\n", SDL_GetError());
+			success = false;
+		}
+	}
+	
+	if(!success)
+	{
+		free();
+	}
+	
+	return success;
+}
+
+void JobSystem::free()
+{
+	if(mWorkers != NULL)
+	{
+		//Tell the workers to stop
+		SDL_LockMutex(mWakeMutex);
+		mQuit = true;
+		SDL_CondBroadcast(mWakeCond);
+		SDL_UnlockMutex(mWakeMutex);
+		
+		//Wait for them and free the queues
+		for(int i = 0; i < mThreadCount; ++i)
+		{
+			if(mWorkers[i].thread != NULL)
+			{
+				SDL_WaitThread(mWorkers[i].thread, NULL);
+			}
+			SDL_DestroyMutex(mWorkers[i].mutex);
+		}
+		
+		delete[] mWorkers;
+		mWorkers = NULL;
+		mThreadCount = 0;
+	}
+	
+	if(mWakeCond != NULL)
+	{
+		SDL_DestroyCond(mWakeCond);
+		mWakeCond = NULL;
+	}
+	
+	if(mWakeMutex != NULL)
+	{
+		SDL_DestroyMutex(mWakeMutex);
+		mWakeMutex = NULL;
+	}
+	
+	SDL_AtomicSet(&mPending, 0);
+	mGeneration = 0;
+	mQuit = false;
+}
+
+void JobSystem::parallelFor(int count, int grain, void (*function)(void* data, int begin, int end), void* data)
+{
+	//Nothing to split, run in place
+	if(mThreadCount <= 1 || count <= grain)
+	{
+		function(data, 0, count);
+		return;
+	}
+	
+	//Count the jobs up front so the barrier can't pass early
+	int totalJobs = (count + grain - 1) / grain;
+	SDL_AtomicAdd(&mPending, totalJobs);
+	
+	//Deal the ranges out over every queue
+	for(int i = 0; i < totalJobs; ++i)
+	{
+		Job job;
+		job.function = function;
+		job.data = data;
+		job.begin = i * grain;
+		job.end = job.begin + grain < count ? job.begin + grain : count;
+		
+		Worker& worker = mWorkers[i % mThreadCount];
+		SDL_LockMutex(worker.mutex);
+		worker.jobs.push_back(job);
+		SDL_UnlockMutex(worker.mutex);
+	}
+	
+	//Wake the workers
+	SDL_LockMutex(mWakeMutex);
+	++mGeneration;
+	SDL_CondBroadcast(mWakeCond);
+	SDL_UnlockMutex(mWakeMutex);
+	
+	//Help out until every job is done
+	while(SDL_AtomicGet(&mPending) > 0)
+	{
+		runJob(0);
+	}
+}
+
+int JobSystem::getThreadCount()
+{
+	return mThreadCount;
+}
+
+int JobSystem::workerMain(void* data)
+{
+	Worker* worker = (Worker*)data;
+	JobSystem* system = worker->system;
+	
+	//The last batch of jobs this worker knows about
+	int seenGeneration = 0;
+	
+	while(true)
+	{
+		//Work until every queue runs dry
+		while(system->runJob(worker->index))
+		{
+		}
+		
+		//Sleep until new jobs arrive
+		SDL_LockMutex(system->mWakeMutex);
+		while(!system->mQuit && system->mGeneration == seenGeneration)
+		{
+			SDL_CondWait(system->mWakeCond, system->mWakeMutex);
+		}
+		seenGeneration = system->mGeneration;
+		bool quit = system->mQuit;
+		SDL_UnlockMutex(system->mWakeMutex);
+		
+		if(quit)
+		{
+			break;
+		}
+	}
+	
+	return 0;
+}
+
+bool JobSystem::runJob(int index)
+{
+	Job job;
+	bool found = false;
+	
+	//Take the newest job from our own queue
+	Worker& own = mWorkers[index];
+	SDL_LockMutex(own.mutex);
+	if(!own.jobs.empty())
+	{
+		job = own.jobs.back();
+		own.jobs.pop_back();
+		found = true;
+	}
+	SDL_UnlockMutex(own.mutex);
+	
+	//Steal the oldest job from someone else
+	for(int i = 1; i < mThreadCount && !found; ++i)
+	{
+		Worker& victim = mWorkers[(index + i) % mThreadCount];
+		SDL_LockMutex(victim.mutex);
+		if(!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			found = true;
+		}
+		SDL_UnlockMutex(victim.mutex);
+	}
+	
+	if(found)
+	{
+		job.function(job.data, job.begin, job.end);
+		SDL_AtomicAdd(&mPending, -1);
+	}
+	
+	return found;
 }
 
 bool init()
@@ -557,6 +1715,16 @@ bool loadMedia()
 		success = false;
 	}
 	
+	//Load the level's wall tree, building and saving it the first time or when the level changed
+	std::vector<SDL_Rect> walls;
+	createLevel(walls);
+	Uint32 levelHash = WallTree::hashWalls(walls);
+	if(!gWalls.loadFromFile("walls.bin", levelHash))
+	{
+		gWalls.build(walls);
+		gWalls.saveToFile("walls.bin", levelHash);
+	}
+	
 	return success;
 }
 
@@ -564,6 +1732,9 @@ void close()
 {
 	//Free loaded images
 	gDotTexture.free();
+	
+	//Free the level
+	gWalls.free();
 
 	/*
 	//Free global font
@@ -649,12 +1820,22 @@ int wmain( int argc, char* args[] )
 			//Event handler
 			SDL_Event e;
 
-			//The dot that will be moving around the screen
-			Dot dot;
+			//The entities moving around the screen
+			EntityStore store;
+			store.reserve(TOTAL_DOTS + 1);
+			
+			//The dot controlled by the player
+			Entity player = store.create(0, 0, 0, 0, &gDotTexture, false);
+			
+			//The dots wandering left of the big wall
+			spawnDots(store, TOTAL_DOTS);
 			
-			//Set the wall
-			SDL_Rect wall;
-			wall = {300, 40, 40, 400};
+			//One thread per core, or everything on this thread if they can't start
+			JobSystem jobs;
+			if(!jobs.init(SDL_GetCPUCount()))
+			{
+				printf("Warning: Unable to start the job system, moving the dots on this thread!\n");
+			}
 
 			//While application is running
 			while( !quit )
@@ -669,23 +1850,32 @@ int wmain( int argc, char* args[] )
 						quit = true;
 					}
 					
-					//Handle input for the dot
-					dot.handleEvent(e);
+					//Run the scaling benchmark on B
+					if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_b)
+					{
+						runScalingBenchmark();
+					}
+					
+					//Handle input for the player's dot
+					handleInput(store, player, e);
 				}
 
-				//Move the dot
-				dot.move(wall);
+				//Move the dots on every core, returns once all of them moved
+				moveSystem(jobs, store, gWalls);
 				
 				//Clear screen
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 				SDL_RenderClear( gRenderer );
 
-				//Render wall
+				//Render walls
 				SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0x00);
-				SDL_RenderDrawRect(gRenderer, &wall);
+				for(int i = 0; i < gWalls.getWallCount(); ++i)
+				{
+					SDL_RenderDrawRect(gRenderer, &gWalls.getWall(i));
+				}
 				
 				//Render objects
-				dot.render();
+				renderSystem(store);
 
 				//Update screen
 				SDL_RenderPresent( gRenderer );
@@ -5,11 +5,29 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <cmath>
+#include <sstream>
+
+//SSE2 is always there on x64 and on x86 builds with /arch:SSE2, the compiler default
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Collision benchmark workload
+const int BENCHMARK_CIRCLES = 50000;
+const int BENCHMARK_WORLD_SIZE = 4096;
+const int BENCHMARK_QUERIES = 1000;
+
+//Screen sized boxes the benchmark finds every circle touching
+const int BENCHMARK_BOXES = 100;
+
 //A circle structure
 struct Circle
 {
@@ -17,6 +35,42 @@ struct Circle
 	int r;
 };
 
+//Many circles stored as structure of arrays for batched queries
+class CircleSet
+{
+	public:
+		//Adds a circle to the end of the set
+		void add(Circle& circle);
+		
+		//Removes every circle
+		void clear();
+		
+		//Gets the number of circles
+		int getSize();
+		
+		//Circle centers
+		std::vector<float> x, y;
+		
+		//Circle radii
+		std::vector<float> r;
+};
+
+//Where a moving shape first touches another
+struct SweepHit
+{
+	//Fraction of the move made before the contact
+	float time;
+	
+	//Unit normal of the touched surface
+	float normalX, normalY;
+};
+
+//A pair of overlapping circles, indices into a circle set
+struct CollisionPair
+{
+	int a, b;
+};
+
 //Texture wrapper class
 class LTexture
 {
@@ -113,7 +167,7 @@ class Dot
 		void handleEvent(SDL_Event& e);
 		
 		//Moves the dot
-		void move(SDL_Rect& square, Circle& circle);
+		void move(SDL_Rect& square, CircleSet& circles);
 		
 		//Shows the dot on the scren
 		void render();
@@ -151,8 +205,32 @@ bool checkCollision(Circle& a, Circle& b);
 //Circle/Box collision detector
 bool checkCollision(Circle& a, SDL_Rect& b);
 
+//Circle/Circle set collision detector, true if the circle touches any in the set
+bool checkCollision(Circle& a, CircleSet& b);
+
+//Circle set/Box collision detector, flags every circle touching the box and returns the count
+int checkCollisions(CircleSet& a, SDL_Rect& b, std::vector<Uint8>& hits);
+
+//Finds every pair of touching circles in the set with sweep and prune
+void findCollisions(CircleSet& circles, std::vector<CollisionPair>& pairs);
+
+//Times the batched queries and the broad phase against the pairwise ones
+void runCollisionBenchmark();
+
+//Point/Circle sweep, finds when a point moving by (velX, velY) first enters the circle
+bool sweepCollision(float x, float y, float velX, float velY, float centerX, float centerY, float radius, SweepHit& hit);
+
+//Point/Box sweep, finds when a point moving by (velX, velY) first enters the box with the given sides
+bool sweepCollision(float x, float y, float velX, float velY, float left, float top, float right, float bottom, SweepHit& hit);
+
+//Moving circle/Box sweep, finds when the circle at (x, y) moving by (velX, velY) first touches the box
+bool sweepCollision(float x, float y, float r, float velX, float velY, SDL_Rect& b, SweepHit& hit);
+
+//Moving circle/Circle set sweep, finds the first circle in the set touched during the move
+bool sweepCollision(float x, float y, float r, float velX, float velY, CircleSet& b, SweepHit& hit);
+
 //Calculates distance squared between two points
-double distanceSquared(int x1, int y1, int x2, int y2);
+int distanceSquared(int x1, int y1, int x2, int y2);
 
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
@@ -461,32 +539,89 @@ void Dot::handleEvent(SDL_Event& e)
 	}
 }
 
-void Dot::move(SDL_Rect& square, Circle& circle)
+void Dot::move(SDL_Rect& square, CircleSet& circles)
 {
-	//Move the dot left or right
-	mPosX += mVelX;
-	shiftColliders();
+	//Where the dot is and how far it still has to go this frame
+	float x = (float)mPosX;
+	float y = (float)mPosY;
+	float moveX = (float)mVelX;
+	float moveY = (float)mVelY;
+	float radius = (float)mCollider.r;
 	
-	//If the dot went too far to the left or right
-	if((mPosX - mCollider.r < 0) || (mPosX + mCollider.r > SCREEN_WIDTH) 
-		|| checkCollision(mCollider, square) || checkCollision(mCollider, circle))
+	//Move up to the first contact, then slide along what was hit with the rest of the move
+	for(int pass = 0; pass < 2 && (moveX != 0.f || moveY != 0.f); ++pass)
 	{
-		//Move back 
-		mPosX -= mVelX;
-		shiftColliders();
+		//Find the earliest contact
+		SweepHit hit;
+		hit.time = 1.f;
+		bool collided = false;
+		
+		SweepHit candidate;
+		if(sweepCollision(x, y, radius, moveX, moveY, square, candidate) && candidate.time < hit.time)
+		{
+			hit = candidate;
+			collided = true;
+		}
+		if(sweepCollision(x, y, radius, moveX, moveY, circles, candidate) && candidate.time < hit.time)
+		{
+			hit = candidate;
+			collided = true;
+		}
+		
+		//Move up to the contact
+		x += moveX * hit.time;
+		y += moveY * hit.time;
+		
+		if(!collided)
+		{
+			break;
+		}
+		
+		//Drop the part of what's left of the move that goes into the surface
+		moveX *= 1.f - hit.time;
+		moveY *= 1.f - hit.time;
+		float into = moveX * hit.normalX + moveY * hit.normalY;
+		moveX -= into * hit.normalX;
+		moveY -= into * hit.normalY;
 	}
 	
-	//Move the dot up or down
-	mPosY += mVelY;
+	//Keep the dot on the screen
+	if(x - radius < 0.f)
+	{
+		x = radius;
+	}
+	else if(x + radius > SCREEN_WIDTH)
+	{
+		x = SCREEN_WIDTH - radius;
+	}
+	if(y - radius < 0.f)
+	{
+		y = radius;
+	}
+	else if(y + radius > SCREEN_HEIGHT)
+	{
+		y = SCREEN_HEIGHT - radius;
+	}
+	
+	//Round the move towards where it started
+	int startX = mPosX;
+	int startY = mPosY;
+	mPosX += (int)(x - mPosX);
+	mPosY += (int)(y - mPosY);
 	shiftColliders();
 	
-	//If the dot went too far up or down
-	if((mPosY - mCollider.r < 0) || (mPosY + mCollider.r > SCREEN_HEIGHT) 
-		|| checkCollision(mCollider, square) || checkCollision(mCollider, circle))
+	//Rounding next to a curved surface can still end up a pixel inside it,
+	//so fall back to keeping one axis and then both where they started
+	if(mPosX != startX || mPosY != startY)
 	{
-		//Move back
-		mPosY -= mVelY;
-		shiftColliders();
+		int roundedX = mPosX;
+		int roundedY = mPosY;
+		for(int fallback = 0; fallback < 3 && (checkCollision(mCollider, square) || checkCollision(mCollider, circles)); ++fallback)
+		{
+			mPosX = fallback == 1 ? roundedX : startX;
+			mPosY = fallback == 0 ? roundedY : startY;
+			shiftColliders();
+		}
 	}
 }
 
@@ -508,6 +643,25 @@ Circle& Dot::getCollider()
 	return mCollider;
 }
 
+void CircleSet::add(Circle& circle)
+{
+	x.push_back((float)circle.x);
+	y.push_back((float)circle.y);
+	r.push_back((float)circle.r);
+}
+
+void CircleSet::clear()
+{
+	x.clear();
+	y.clear();
+	r.clear();
+}
+
+int CircleSet::getSize()
+{
+	return (int)x.size();
+}
+
 bool init()
 {
 	//Initialization flag
@@ -676,7 +830,435 @@ bool checkCollision(Circle& a, SDL_Rect& b)
 	return false;
 }
 
-double distanceSquared(int x1, int y1, int x2, int y2)
+bool checkCollision(Circle& a, CircleSet& b)
+{
+	int count = b.getSize();
+	const float* bX = b.x.data();
+	const float* bY = b.y.data();
+	const float* bR = b.r.data();
+	
+	//The circle being tested
+	float aX = (float)a.x;
+	float aY = (float)a.y;
+	float aR = (float)a.r;
+	
+	int i = 0;
+	
+	#ifdef USE_SSE2
+	//Test four circles at a time
+	__m128 centerX = _mm_set1_ps(aX);
+	__m128 centerY = _mm_set1_ps(aY);
+	__m128 radius = _mm_set1_ps(aR);
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 deltaX = _mm_sub_ps(_mm_loadu_ps(bX + i), centerX);
+		__m128 deltaY = _mm_sub_ps(_mm_loadu_ps(bY + i), centerY);
+		__m128 totalRadius = _mm_add_ps(_mm_loadu_ps(bR + i), radius);
+		__m128 distance = _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY));
+		
+		//If any of the four is closer than the sum of the radii
+		if(_mm_movemask_ps(_mm_cmplt_ps(distance, _mm_mul_ps(totalRadius, totalRadius))) != 0)
+		{
+			return true;
+		}
+	}
+	#endif
+	
+	//Test whatever is left one at a time
+	for(; i < count; ++i)
+	{
+		float deltaX = bX[i] - aX;
+		float deltaY = bY[i] - aY;
+		float totalRadius = bR[i] + aR;
+		if(deltaX * deltaX + deltaY * deltaY < totalRadius * totalRadius)
+		{
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+int checkCollisions(CircleSet& a, SDL_Rect& b, std::vector<Uint8>& hits)
+{
+	int count = a.getSize();
+	const float* aX = a.x.data();
+	const float* aY = a.y.data();
+	const float* aR = a.r.data();
+	hits.resize(count);
+	
+	//The sides of the box
+	float left = (float)b.x;
+	float right = (float)(b.x + b.w);
+	float top = (float)b.y;
+	float bottom = (float)(b.y + b.h);
+	
+	int total = 0;
+	int i = 0;
+	
+	#ifdef USE_SSE2
+	//Clamp four centers to the box at a time to find their closest points
+	__m128 boxLeft = _mm_set1_ps(left);
+	__m128 boxRight = _mm_set1_ps(right);
+	__m128 boxTop = _mm_set1_ps(top);
+	__m128 boxBottom = _mm_set1_ps(bottom);
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 centerX = _mm_loadu_ps(aX + i);
+		__m128 centerY = _mm_loadu_ps(aY + i);
+		__m128 radius = _mm_loadu_ps(aR + i);
+		__m128 deltaX = _mm_sub_ps(_mm_min_ps(_mm_max_ps(centerX, boxLeft), boxRight), centerX);
+		__m128 deltaY = _mm_sub_ps(_mm_min_ps(_mm_max_ps(centerY, boxTop), boxBottom), centerY);
+		__m128 distance = _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY));
+		int mask = _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_mul_ps(radius, radius)));
+		
+		//Unpack the hit bits
+		hits[i] = mask & 1;
+		hits[i + 1] = (mask >> 1) & 1;
+		hits[i + 2] = (mask >> 2) & 1;
+		hits[i + 3] = (mask >> 3) & 1;
+		total += hits[i] + hits[i + 1] + hits[i + 2] + hits[i + 3];
+	}
+	#endif
+	
+	//Test whatever is left one at a time
+	for(; i < count; ++i)
+	{
+		float closestX = aX[i] < left ? left : (aX[i] > right ? right : aX[i]);
+		float closestY = aY[i] < top ? top : (aY[i] > bottom ? bottom : aY[i]);
+		float deltaX = closestX - aX[i];
+		float deltaY = closestY - aY[i];
+		hits[i] = deltaX * deltaX + deltaY * deltaY < aR[i] * aR[i];
+		total += hits[i];
+	}
+	
+	return total;
+}
+
+//Orders circle indices by the left edge of the circle
+struct LeftEdgeLess
+{
+	const float* x;
+	const float* r;
+	
+	bool operator()(int a, int b) const
+	{
+		return x[a] - r[a] < x[b] - r[b];
+	}
+};
+
+void findCollisions(CircleSet& circles, std::vector<CollisionPair>& pairs)
+{
+	pairs.clear();
+	
+	int count = circles.getSize();
+	const float* x = circles.x.data();
+	const float* y = circles.y.data();
+	const float* r = circles.r.data();
+	
+	//Sort the circles along the x axis
+	std::vector<int> order(count);
+	for(int i = 0; i < count; ++i)
+	{
+		order[i] = i;
+	}
+	LeftEdgeLess less = { x, r };
+	std::sort(order.begin(), order.end(), less);
+	
+	//Sweep left to right keeping the circles whose x extent is still open
+	std::vector<int> active;
+	for(int i = 0; i < count; ++i)
+	{
+		int current = order[i];
+		float left = x[current] - r[current];
+		
+		for(int j = 0; j < (int)active.size(); )
+		{
+			int other = active[j];
+			
+			//Drop circles that ended before this one starts
+			if(x[other] + r[other] < left)
+			{
+				active[j] = active.back();
+				active.pop_back();
+				continue;
+			}
+			
+			//The x extents overlap, do the exact test
+			float deltaX = x[other] - x[current];
+			float deltaY = y[other] - y[current];
+			float totalRadius = r[other] + r[current];
+			if(deltaX * deltaX + deltaY * deltaY < totalRadius * totalRadius)
+			{
+				CollisionPair pair = { other, current };
+				pairs.push_back(pair);
+			}
+			
+			++j;
+		}
+		
+		active.push_back(current);
+	}
+}
+
+void runCollisionBenchmark()
+{
+	//Scatter the circles over a world much bigger than the screen
+	std::vector<Circle> circles(BENCHMARK_CIRCLES);
+	CircleSet circleSet;
+	for(int i = 0; i < BENCHMARK_CIRCLES; ++i)
+	{
+		circles[i].x = rand() % BENCHMARK_WORLD_SIZE;
+		circles[i].y = rand() % BENCHMARK_WORLD_SIZE;
+		circles[i].r = 2 + rand() % 9;
+		circleSet.add(circles[i]);
+	}
+	
+	//The circles being queried against the set
+	std::vector<Circle> queries(BENCHMARK_QUERIES);
+	for(int i = 0; i < BENCHMARK_QUERIES; ++i)
+	{
+		queries[i].x = rand() % BENCHMARK_WORLD_SIZE;
+		queries[i].y = rand() % BENCHMARK_WORLD_SIZE;
+		queries[i].r = Dot::DOT_WIDTH / 2;
+	}
+	
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	
+	//One circle against the whole set, one pair at a time
+	int pairwiseHits = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < BENCHMARK_QUERIES; ++i)
+	{
+		for(int j = 0; j < BENCHMARK_CIRCLES; ++j)
+		{
+			if(checkCollision(queries[i], circles[j]))
+			{
+				++pairwiseHits;
+				break;
+			}
+		}
+	}
+	double pairwiseTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / frequency;
+	
+	//One circle against the whole set, batched
+	int batchedHits = 0;
+	start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < BENCHMARK_QUERIES; ++i)
+	{
+		batchedHits += checkCollision(queries[i], circleSet) ? 1 : 0;
+	}
+	double batchedTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / frequency;
+	
+	//Screen sized boxes against every circle, one pair at a time
+	std::vector<SDL_Rect> boxes(BENCHMARK_BOXES);
+	for(int i = 0; i < BENCHMARK_BOXES; ++i)
+	{
+		boxes[i].x = rand() % (BENCHMARK_WORLD_SIZE - SCREEN_WIDTH);
+		boxes[i].y = rand() % (BENCHMARK_WORLD_SIZE - SCREEN_HEIGHT);
+		boxes[i].w = SCREEN_WIDTH;
+		boxes[i].h = SCREEN_HEIGHT;
+	}
+	int pairwiseBoxHits = 0;
+	start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < BENCHMARK_BOXES; ++i)
+	{
+		for(int j = 0; j < BENCHMARK_CIRCLES; ++j)
+		{
+			pairwiseBoxHits += checkCollision(circles[j], boxes[i]) ? 1 : 0;
+		}
+	}
+	double pairwiseBoxTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / frequency;
+	
+	//Screen sized boxes against every circle, batched
+	int batchedBoxHits = 0;
+	std::vector<Uint8> hits;
+	start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < BENCHMARK_BOXES; ++i)
+	{
+		batchedBoxHits += checkCollisions(circleSet, boxes[i], hits);
+	}
+	double batchedBoxTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / frequency;
+	
+	//Every circle against every other with the broad phase
+	std::vector<CollisionPair> pairs;
+	start = SDL_GetPerformanceCounter();
+	findCollisions(circleSet, pairs);
+	double sweepTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / frequency;
+	
+	std::stringstream results;
+	results << BENCHMARK_QUERIES << " queries vs " << BENCHMARK_CIRCLES << " circles: pairwise " << pairwiseTime << "ms (" << pairwiseHits
+		<< " hits), batched " << batchedTime << "ms (" << batchedHits << " hits); " << BENCHMARK_BOXES << " boxes: pairwise " << pairwiseBoxTime 
+		<< "ms (" << pairwiseBoxHits << " hits), batched " << batchedBoxTime << "ms (" << batchedBoxHits << " hits); sweep and prune " << sweepTime 
+		<< "ms (" << pairs.size() << " pairs)";
+	printf("%s\n", results.str().c_str());
+	SDL_SetWindowTitle(gWindow, results.str().c_str());
+}
+
+bool sweepCollision(float x, float y, float velX, float velY, float centerX, float centerY, float radius, SweepHit& hit)
+{
+	//Offset from the center
+	float deltaX = x - centerX;
+	float deltaY = y - centerY;
+	
+	//Solve |delta + vel * t| = radius for t
+	float a = velX * velX + velY * velY;
+	float b = deltaX * velX + deltaY * velY;
+	float c = deltaX * deltaX + deltaY * deltaY - radius * radius;
+	
+	//Not moving or moving away
+	if(a == 0.f || b >= 0.f)
+	{
+		return false;
+	}
+	
+	//Already inside and moving further in, stop right away
+	if(c < 0.f)
+	{
+		float length = sqrtf(deltaX * deltaX + deltaY * deltaY);
+		hit.time = 0.f;
+		hit.normalX = length > 0.f ? deltaX / length : 0.f;
+		hit.normalY = length > 0.f ? deltaY / length : 0.f;
+		return true;
+	}
+	
+	//Misses or only grazes the circle
+	float discriminant = b * b - a * c;
+	if(discriminant <= 0.f)
+	{
+		return false;
+	}
+	
+	//Enters after the move is over
+	float time = (-b - sqrtf(discriminant)) / a;
+	if(time >= 1.f)
+	{
+		return false;
+	}
+	
+	hit.time = time;
+	hit.normalX = (deltaX + velX * time) / radius;
+	hit.normalY = (deltaY + velY * time) / radius;
+	return true;
+}
+
+bool sweepCollision(float x, float y, float velX, float velY, float left, float top, float right, float bottom, SweepHit& hit)
+{
+	//When the point enters and leaves the box along each axis
+	float entryX, exitX, entryY, exitY;
+	if(velX != 0.f)
+	{
+		float timeLeft = (left - x) / velX;
+		float timeRight = (right - x) / velX;
+		entryX = velX > 0.f ? timeLeft : timeRight;
+		exitX = velX > 0.f ? timeRight : timeLeft;
+	}
+	else if(x <= left || x >= right)
+	{
+		return false;
+	}
+	else
+	{
+		entryX = -HUGE_VALF;
+		exitX = HUGE_VALF;
+	}
+	
+	if(velY != 0.f)
+	{
+		float timeTop = (top - y) / velY;
+		float timeBottom = (bottom - y) / velY;
+		entryY = velY > 0.f ? timeTop : timeBottom;
+		exitY = velY > 0.f ? timeBottom : timeTop;
+	}
+	else if(y <= top || y >= bottom)
+	{
+		return false;
+	}
+	else
+	{
+		entryY = -HUGE_VALF;
+		exitY = HUGE_VALF;
+	}
+	
+	//The point has to be between both pairs of sides at once during the move
+	float entry = entryX > entryY ? entryX : entryY;
+	float exit = exitX < exitY ? exitX : exitY;
+	if(entry >= exit || entry < 0.f || entry >= 1.f)
+	{
+		return false;
+	}
+	
+	//The side entered last is the one touched
+	hit.time = entry;
+	hit.normalX = 0.f;
+	hit.normalY = 0.f;
+	if(entryX > entryY)
+	{
+		hit.normalX = velX > 0.f ? -1.f : 1.f;
+	}
+	else
+	{
+		hit.normalY = velY > 0.f ? -1.f : 1.f;
+	}
+	
+	return true;
+}
+
+bool sweepCollision(float x, float y, float r, float velX, float velY, SDL_Rect& b, SweepHit& hit)
+{
+	//The box grown by the radius has rounded corners, so the center is tested
+	//against the box grown sideways, the box grown up and down and the four corners
+	bool collided = false;
+	hit.time = 1.f;
+	SweepHit candidate;
+	
+	if(sweepCollision(x, y, velX, velY, b.x - r, (float)b.y, b.x + b.w + r, (float)(b.y + b.h), candidate) && candidate.time < hit.time)
+	{
+		hit = candidate;
+		collided = true;
+	}
+	
+	if(sweepCollision(x, y, velX, velY, (float)b.x, b.y - r, (float)(b.x + b.w), b.y + b.h + r, candidate) && candidate.time < hit.time)
+	{
+		hit = candidate;
+		collided = true;
+	}
+	
+	for(int corner = 0; corner < 4; ++corner)
+	{
+		float cornerX = (float)((corner & 1) ? b.x + b.w : b.x);
+		float cornerY = (float)((corner & 2) ? b.y + b.h : b.y);
+		if(sweepCollision(x, y, velX, velY, cornerX, cornerY, r, candidate) && candidate.time < hit.time)
+		{
+			hit = candidate;
+			collided = true;
+		}
+	}
+	
+	return collided;
+}
+
+bool sweepCollision(float x, float y, float r, float velX, float velY, CircleSet& b, SweepHit& hit)
+{
+	bool collided = false;
+	hit.time = 1.f;
+	
+	//Keep the earliest contact
+	int count = b.getSize();
+	for(int i = 0; i < count; ++i)
+	{
+		SweepHit candidate;
+		if(sweepCollision(x, y, velX, velY, b.x[i], b.y[i], b.r[i] + r, candidate) && candidate.time < hit.time)
+		{
+			hit = candidate;
+			collided = true;
+		}
+	}
+	
+	return collided;
+}
+
+int distanceSquared(int x1, int y1, int x2, int y2)
 {
 	int deltaX = x2 - x1;
 	int deltaY = y2 - y1;
@@ -710,6 +1292,10 @@ int wmain( int argc, char* args[] )
 			
 			//The dot that will be collided against
 			Dot otherDot(SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4);
+			
+			//The circles the dot collides against
+			CircleSet obstacles;
+			obstacles.add(otherDot.getCollider());
 
 			//set the wall
 			SDL_Rect wall;
@@ -730,12 +1316,18 @@ int wmain( int argc, char* args[] )
 						quit = true;
 					}
 					
+					//Run the collision benchmark on B
+					if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_b)
+					{
+						runCollisionBenchmark();
+					}
+					
 					//Handle input for the dot
 					dot.handleEvent(e);
 				}
 
 				//Move the dot
-				dot.move(wall, otherDot.getCollider());
+				dot.move(wall, obstacles);
 				
 				//Clear screen
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
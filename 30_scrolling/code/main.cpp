@@ -5,6 +5,8 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <deque>
+#include <algorithm>
 
 //The dimensions of the level
 const int LEVEL_WIDTH = 1280;
@@ -14,6 +16,28 @@ const int LEVEL_HEIGHT = 960;
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Chunk streaming constants
+const int CHUNK_SIZE = 256;
+const int CHUNK_PREFETCH_RADIUS = 1;
+const int CHUNK_LOOKAHEAD = 30;
+const int CHUNK_BUDGET = 48;
+
+//Chunk file header is the level size, chunk size and a hash of the level image
+const int CHUNK_HEADER_VALUES = 4;
+
+//Largest level side a chunk file may claim before it is treated as damaged
+const int CHUNK_MAX_SIDE = 16384;
+
+//Chunk loading states
+enum ChunkState
+{
+	CHUNK_UNLOADED,
+	CHUNK_QUEUED,
+	CHUNK_LOADED,
+	CHUNK_RESIDENT,
+	CHUNK_MISSING
+};
+
 //A circle structure
 struct Circle
 {
@@ -140,6 +164,84 @@ class Dot
 		void shiftColliders();
 };
 
+//Streams fixed size chunks of the level from disk around the camera
+class ChunkStreamer
+{
+	public:
+		//Initializes variables
+		ChunkStreamer();
+
+		//Deallocates memory
+		~ChunkStreamer();
+
+		//Opens the chunk file, cooking it from the level image if needed, and starts the loader
+		bool load(std::string imagePath, std::string chunkPath);
+
+		//Stops the loader and deallocates chunks
+		void free();
+
+		//Requests chunks around the camera, uploads loaded ones and evicts over budget
+		void update(SDL_Rect& camera);
+
+		//Renders the resident chunks in view
+		void render(SDL_Rect& camera);
+
+		//Gets the number of chunks with textures
+		int getResidentCount();
+
+	private:
+		//A chunk of the level
+		struct Chunk
+		{
+			//Loading state, guarded by the lock
+			int state;
+
+			//Pixels read by the loader waiting for upload
+			Uint32* pixels;
+
+			//Texture while resident, only touched by the main thread
+			SDL_Texture* texture;
+		};
+
+		//Cuts the level image into chunks and writes them to the chunk file
+		bool cook(std::string imagePath, std::string chunkPath, Uint32 sourceHash);
+
+		//Opens the chunk file and reads its header, false if it is damaged or cooked from another image
+		bool open(std::string chunkPath, Uint32 sourceHash);
+
+		//Gets the chunk coordinates covering an area
+		void getChunkRange(SDL_Rect& area, int& x1, int& y1, int& x2, int& y2);
+
+		//Queues the unloaded chunks in an area
+		void request(SDL_Rect& area);
+
+		//Destroys the farthest resident chunks outside the area until under budget
+		void evict(SDL_Rect& keep, SDL_Rect& camera);
+
+		//Reads requested chunks on the loader thread
+		static int loader(void* data);
+
+		//The chunk file, only read by the loader
+		SDL_RWops* mFile;
+
+		//Level dimensions in pixels and chunks
+		int mWidth, mHeight;
+		int mChunksAcross, mChunksDown;
+
+		//The chunks and how many have textures
+		std::vector<Chunk> mChunks;
+		int mResident;
+
+		//Camera position last update for the direction of travel
+		int mLastX, mLastY;
+
+		//Loader thread and its request queue
+		SDL_Thread* mThread;
+		SDL_mutex* mLock;
+		SDL_cond* mWake;
+		std::deque<int> mRequests;
+		bool mQuit;
+};
 
 //Starts up SDL and creates window
 bool init();
@@ -159,6 +261,9 @@ bool checkCollision(Circle& a, SDL_Rect& b);
 //Calculates distance squared between two points
 double distanceSquared(int x1, int y1, int x2, int y2);
 
+//Hashes a file's contents, 0 if it can't be read
+Uint32 hashFile(std::string path);
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -170,7 +275,9 @@ SDL_Renderer* gRenderer = NULL;
 
 //Scene textures
 LTexture gDotTexture;
-LTexture gBGTexture;
+
+//Streamed level
+ChunkStreamer gLevel;
 
 LTexture::LTexture()
 {
@@ -507,6 +614,433 @@ int Dot::getPosY(void)
 	return mPosY;
 }
 
+ChunkStreamer::ChunkStreamer()
+{
+	//Initialize
+	mFile = NULL;
+	mWidth = 0;
+	mHeight = 0;
+	mChunksAcross = 0;
+	mChunksDown = 0;
+	mResident = 0;
+	mLastX = 0;
+	mLastY = 0;
+	mThread = NULL;
+	mLock = NULL;
+	mWake = NULL;
+	mQuit = false;
+}
+
+ChunkStreamer::~ChunkStreamer()
+{
+	//Deallocate
+	free();
+}
+
+bool ChunkStreamer::load(std::string imagePath, std::string chunkPath)
+{
+	//Get rid of preexisting chunks
+	free();
+
+	//Cook the chunk file the first time and whenever the level image changes
+	Uint32 sourceHash = hashFile(imagePath);
+	if(!open(chunkPath, sourceHash))
+	{
+		if(!cook(imagePath, chunkPath, sourceHash))
+		{
+			return false;
+		}
+		if(!open(chunkPath, sourceHash))
+		{
+			printf("Unable to open chunk file %s!\n", chunkPath.c_str());
+			return false;
+		}
+	}
+
+	Chunk empty = {CHUNK_UNLOADED, NULL, NULL};
+	mChunks.assign(mChunksAcross * mChunksDown, empty);
+
+	//Start the loader
+	mQuit = false;
+	mLock = SDL_CreateMutex();
+	mWake = SDL_CreateCond();
+	mThread = SDL_CreateThread(loader, "ChunkLoader", this);
+	if(mThread == NULL)
+	{
+		printf("Unable to create chunk loader! SDL Error: %s\n", SDL_GetError());
+		free();
+		return false;
+	}
+
+	return true;
+}
+
+bool ChunkStreamer::open(std::string chunkPath, Uint32 sourceHash)
+{
+	mFile = SDL_RWFromFile(chunkPath.c_str(), "rb");
+	if(mFile == NULL)
+	{
+		return false;
+	}
+
+	//An unreadable image leaves the chunk file as the only copy
+	Sint32 header[CHUNK_HEADER_VALUES];
+	bool success = SDL_RWread(mFile, header, sizeof(Sint32), CHUNK_HEADER_VALUES) == CHUNK_HEADER_VALUES && header[2] == CHUNK_SIZE &&
+		(sourceHash == 0 || (Uint32)header[3] == sourceHash) &&
+		header[0] > 0 && header[0] <= CHUNK_MAX_SIDE && header[1] > 0 && header[1] <= CHUNK_MAX_SIDE;
+	if(success)
+	{
+		mWidth = header[0];
+		mHeight = header[1];
+		mChunksAcross = (mWidth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		mChunksDown = (mHeight + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+		//Every chunk has to be there so the loader never reads short
+		Sint64 chunkBytes = (Sint64)CHUNK_SIZE * CHUNK_SIZE * (Sint64)sizeof(Uint32);
+		success = SDL_RWsize(mFile) == CHUNK_HEADER_VALUES * (Sint64)sizeof(Sint32) + (Sint64)mChunksAcross * mChunksDown * chunkBytes;
+	}
+	if(!success)
+	{
+		printf("Chunk file %s is out of date or damaged, cooking it again\n", chunkPath.c_str());
+		SDL_RWclose(mFile);
+		mFile = NULL;
+	}
+
+	return success;
+}
+
+bool ChunkStreamer::cook(std::string imagePath, std::string chunkPath, Uint32 sourceHash)
+{
+	//Load the level image as 32 bit pixels
+	SDL_Surface* loadedSurface = IMG_Load(imagePath.c_str());
+	if(loadedSurface == NULL)
+	{
+		printf("Unable to load image %s! SDL_image Error: %s\n", imagePath.c_str(), IMG_GetError());
+		return false;
+	}
+	SDL_Surface* level = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+	SDL_FreeSurface(loadedSurface);
+	if(level == NULL)
+	{
+		printf("Unable to convert image %s! SDL Error: %s\n", imagePath.c_str(), SDL_GetError());
+		return false;
+	}
+
+	SDL_RWops* file = SDL_RWFromFile(chunkPath.c_str(), "wb");
+	if(file == NULL)
+	{
+		printf("Unable to create chunk file %s! SDL Error: %s\n", chunkPath.c_str(), SDL_GetError());
+		SDL_FreeSurface(level);
+		return false;
+	}
+
+	//Write the level and chunk dimensions and the image they came from
+	Sint32 header[CHUNK_HEADER_VALUES] = {level->w, level->h, CHUNK_SIZE, (Sint32)sourceHash};
+	bool success = SDL_RWwrite(file, header, sizeof(Sint32), CHUNK_HEADER_VALUES) == CHUNK_HEADER_VALUES;
+
+	//Write every chunk row by row, padding the edges
+	std::vector<Uint32> chunk(CHUNK_SIZE * CHUNK_SIZE);
+	for(int cy = 0; cy < level->h && success; cy += CHUNK_SIZE)
+	{
+		for(int cx = 0; cx < level->w && success; cx += CHUNK_SIZE)
+		{
+			std::fill(chunk.begin(), chunk.end(), 0);
+			int w = SDL_min(CHUNK_SIZE, level->w - cx);
+			int h = SDL_min(CHUNK_SIZE, level->h - cy);
+			for(int y = 0; y < h; ++y)
+			{
+				Uint32* row = (Uint32*)((Uint8*)level->pixels + (cy + y) * level->pitch) + cx;
+				std::copy(row, row + w, chunk.begin() + y * CHUNK_SIZE);
+			}
+			success = SDL_RWwrite(file, &chunk[0], sizeof(Uint32), chunk.size()) == chunk.size();
+		}
+	}
+
+	if(!success)
+	{
+		printf("Unable to write chunk file %s! SDL Error: %s\n", chunkPath.c_str(), SDL_GetError());
+	}
+
+	SDL_RWclose(file);
+	SDL_FreeSurface(level);
+	return success;
+}
+
+void ChunkStreamer::free()
+{
+	//Stop the loader
+	if(mThread != NULL)
+	{
+		SDL_LockMutex(mLock);
+		mQuit = true;
+		SDL_CondSignal(mWake);
+		SDL_UnlockMutex(mLock);
+		SDL_WaitThread(mThread, NULL);
+		mThread = NULL;
+	}
+	if(mWake != NULL)
+	{
+		SDL_DestroyCond(mWake);
+		mWake = NULL;
+	}
+	if(mLock != NULL)
+	{
+		SDL_DestroyMutex(mLock);
+		mLock = NULL;
+	}
+	if(mFile != NULL)
+	{
+		SDL_RWclose(mFile);
+		mFile = NULL;
+	}
+
+	//Free the chunks
+	for(size_t i = 0; i < mChunks.size(); ++i)
+	{
+		delete[] mChunks[i].pixels;
+		if(mChunks[i].texture != NULL)
+		{
+			SDL_DestroyTexture(mChunks[i].texture);
+		}
+	}
+	mChunks.clear();
+	mRequests.clear();
+	mResident = 0;
+	mWidth = 0;
+	mHeight = 0;
+	mChunksAcross = 0;
+	mChunksDown = 0;
+}
+
+void ChunkStreamer::getChunkRange(SDL_Rect& area, int& x1, int& y1, int& x2, int& y2)
+{
+	//Clamp the covered chunks to the level
+	x1 = SDL_max(area.x / CHUNK_SIZE, 0);
+	y1 = SDL_max(area.y / CHUNK_SIZE, 0);
+	x2 = SDL_min((area.x + area.w - 1) / CHUNK_SIZE, mChunksAcross - 1);
+	y2 = SDL_min((area.y + area.h - 1) / CHUNK_SIZE, mChunksDown - 1);
+}
+
+void ChunkStreamer::request(SDL_Rect& area)
+{
+	int x1, y1, x2, y2;
+	getChunkRange(area, x1, y1, x2, y2);
+	for(int y = y1; y <= y2; ++y)
+	{
+		for(int x = x1; x <= x2; ++x)
+		{
+			Chunk& chunk = mChunks[y * mChunksAcross + x];
+			if(chunk.state == CHUNK_UNLOADED)
+			{
+				chunk.state = CHUNK_QUEUED;
+				mRequests.push_back(y * mChunksAcross + x);
+			}
+		}
+	}
+}
+
+void ChunkStreamer::update(SDL_Rect& camera)
+{
+	if(mThread == NULL)
+	{
+		return;
+	}
+
+	//Get the direction of travel
+	int velX = camera.x - mLastX;
+	int velY = camera.y - mLastY;
+	mLastX = camera.x;
+	mLastY = camera.y;
+
+	//The view plus a ring of chunks, and the same area pushed ahead of the camera
+	SDL_Rect nearby = {camera.x - CHUNK_PREFETCH_RADIUS * CHUNK_SIZE, camera.y - CHUNK_PREFETCH_RADIUS * CHUNK_SIZE, camera.w + 2 * CHUNK_PREFETCH_RADIUS * CHUNK_SIZE, camera.h + 2 * CHUNK_PREFETCH_RADIUS * CHUNK_SIZE};
+	SDL_Rect ahead = {nearby.x + velX * CHUNK_LOOKAHEAD, nearby.y + velY * CHUNK_LOOKAHEAD, nearby.w, nearby.h};
+
+	SDL_LockMutex(mLock);
+
+	//Drop stale requests so the loader follows the camera
+	for(size_t i = 0; i < mRequests.size(); ++i)
+	{
+		mChunks[mRequests[i]].state = CHUNK_UNLOADED;
+	}
+	mRequests.clear();
+
+	//Queue what is on screen first, then the direction of travel, then the rest of the ring
+	request(camera);
+	request(ahead);
+	request(nearby);
+	if(!mRequests.empty())
+	{
+		SDL_CondSignal(mWake);
+	}
+
+	//Upload chunks the loader finished
+	for(size_t i = 0; i < mChunks.size(); ++i)
+	{
+		Chunk& chunk = mChunks[i];
+		if(chunk.state == CHUNK_LOADED)
+		{
+			chunk.texture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, CHUNK_SIZE, CHUNK_SIZE);
+			if(chunk.texture == NULL)
+			{
+				printf("Unable to create chunk texture! SDL Error: %s\n", SDL_GetError());
+				chunk.state = CHUNK_MISSING;
+			}
+			else
+			{
+				SDL_UpdateTexture(chunk.texture, NULL, chunk.pixels, CHUNK_SIZE * sizeof(Uint32));
+				chunk.state = CHUNK_RESIDENT;
+				++mResident;
+			}
+			delete[] chunk.pixels;
+			chunk.pixels = NULL;
+		}
+	}
+
+	//Keep memory flat
+	SDL_Rect keep;
+	SDL_UnionRect(&nearby, &ahead, &keep);
+	evict(keep, camera);
+
+	SDL_UnlockMutex(mLock);
+}
+
+void ChunkStreamer::evict(SDL_Rect& keep, SDL_Rect& camera)
+{
+	int centerX = camera.x + camera.w / 2;
+	int centerY = camera.y + camera.h / 2;
+	while(mResident > CHUNK_BUDGET)
+	{
+		//Find the farthest resident chunk, preferring ones outside the prefetch area
+		int farthest = -1;
+		bool farthestKept = true;
+		int farthestDistance = -1;
+		for(int i = 0; i < (int)mChunks.size(); ++i)
+		{
+			if(mChunks[i].state != CHUNK_RESIDENT)
+			{
+				continue;
+			}
+
+			SDL_Rect box = {(i % mChunksAcross) * CHUNK_SIZE, (i / mChunksAcross) * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE};
+			if(SDL_HasIntersection(&box, &camera))
+			{
+				continue;
+			}
+
+			bool kept = SDL_HasIntersection(&box, &keep) == SDL_TRUE;
+			int dx = box.x + CHUNK_SIZE / 2 - centerX;
+			int dy = box.y + CHUNK_SIZE / 2 - centerY;
+			int distance = dx * dx + dy * dy;
+			if((farthestKept && !kept) || (kept == farthestKept && distance > farthestDistance))
+			{
+				farthest = i;
+				farthestKept = kept;
+				farthestDistance = distance;
+			}
+		}
+
+		//Everything left is on screen
+		if(farthest == -1)
+		{
+			break;
+		}
+
+		SDL_DestroyTexture(mChunks[farthest].texture);
+		mChunks[farthest].texture = NULL;
+		mChunks[farthest].state = CHUNK_UNLOADED;
+		--mResident;
+	}
+}
+
+void ChunkStreamer::render(SDL_Rect& camera)
+{
+	//Render the resident chunks in view, leaving gaps for ones still loading
+	int x1, y1, x2, y2;
+	getChunkRange(camera, x1, y1, x2, y2);
+	for(int y = y1; y <= y2; ++y)
+	{
+		for(int x = x1; x <= x2; ++x)
+		{
+			SDL_Texture* texture = mChunks[y * mChunksAcross + x].texture;
+			if(texture != NULL)
+			{
+				SDL_Rect renderQuad = {x * CHUNK_SIZE - camera.x, y * CHUNK_SIZE - camera.y, CHUNK_SIZE, CHUNK_SIZE};
+				SDL_RenderCopy(gRenderer, texture, NULL, &renderQuad);
+			}
+		}
+	}
+}
+
+int ChunkStreamer::getResidentCount()
+{
+	return mResident;
+}
+
+int ChunkStreamer::loader(void* data)
+{
+	ChunkStreamer* streamer = (ChunkStreamer*)data;
+	const int chunkPixels = CHUNK_SIZE * CHUNK_SIZE;
+
+	SDL_LockMutex(streamer->mLock);
+	while(!streamer->mQuit)
+	{
+		//Sleep until there is work
+		if(streamer->mRequests.empty())
+		{
+			SDL_CondWait(streamer->mWake, streamer->mLock);
+			continue;
+		}
+		int index = streamer->mRequests.front();
+		streamer->mRequests.pop_front();
+
+		//Read the chunk without holding the lock
+		SDL_UnlockMutex(streamer->mLock);
+		Uint32* pixels = new Uint32[chunkPixels];
+		Sint64 offset = CHUNK_HEADER_VALUES * (Sint64)sizeof(Sint32) + (Sint64)index * chunkPixels * (Sint64)sizeof(Uint32);
+		if(SDL_RWseek(streamer->mFile, offset, RW_SEEK_SET) != offset || SDL_RWread(streamer->mFile, pixels, sizeof(Uint32), chunkPixels) != (size_t)chunkPixels)
+		{
+			printf("Unable to read chunk %d! SDL Error: %s\n", index, SDL_GetError());
+			delete[] pixels;
+			pixels = NULL;
+		}
+		SDL_LockMutex(streamer->mLock);
+
+		//Hand it to the main thread for upload
+		Chunk& chunk = streamer->mChunks[index];
+		chunk.pixels = pixels;
+		chunk.state = pixels != NULL ? CHUNK_LOADED : CHUNK_MISSING;
+	}
+	SDL_UnlockMutex(streamer->mLock);
+
+	return 0;
+}
+
+Uint32 hashFile(std::string path)
+{
+	SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+	if(file == NULL)
+	{
+		return 0;
+	}
+
+	//FNV-1a over every byte
+	Uint32 hash = 2166136261u;
+	Uint8 buffer[4096];
+	size_t read;
+	while((read = SDL_RWread(file, buffer, 1, sizeof(buffer))) > 0)
+	{
+		for(size_t i = 0; i < read; ++i)
+		{
+			hash = (hash ^ buffer[i]) * 16777619u;
+		}
+	}
+	SDL_RWclose(file);
+
+	//Keep 0 for unreadable files
+	return hash != 0 ? hash : 1;
+}
+
 bool init()
 {
 	//Initialization flag
@@ -588,9 +1122,9 @@ bool loadMedia()
 		success = false;
 	}
 	
-	if(!gBGTexture.loadFromFile("bg.png"))
+	if(!gLevel.load("bg.png", "bg.chunks"))
 	{
-		printf("Failed to load background texture! SDL Error: %s\n", SDL_GetError());
+		printf("Failed to load level chunks!\n");
 		success = false;
 	}
 	
@@ -602,7 +1136,7 @@ void close()
 	//Free loaded images
 	gDotTexture.free();
 
-	gBGTexture.free();
+	gLevel.free();
 	
 	/*
 	//Free global font
@@ -758,13 +1292,16 @@ int wmain( int argc, char* args[] )
 				{
 					camera.y = LEVEL_HEIGHT - camera.h;
 				}
+
+				//Stream in the level around the camera
+				gLevel.update(camera);
 		
 				//Clear screen
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 				SDL_RenderClear( gRenderer );
 				
 				//Render background
-				gBGTexture.render(0, 0, &camera);
+				gLevel.render(camera);
 
 				//Render dots
 				dot.render(camera.x, camera.y);
@@ -5,6 +5,8 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <deque>
+#include <sstream>
 
 
 //Screen dimension constants
@@ -15,6 +17,32 @@ const int SCREEN_HEIGHT = 480;
 const int LEVEL_WIDTH = SCREEN_WIDTH;
 const int LEVEL_HEIGHT = SCREEN_HEIGHT;
 
+//Width of the vertical strips panoramas are streamed in
+const int STRIP_WIDTH = 256;
+
+//Strips decoded ahead of the view on either side
+const int STRIP_PREFETCH = 1;
+
+//Strip loading states
+enum StripState
+{
+	STRIP_UNLOADED,
+	STRIP_QUEUED,
+	STRIP_LOADED,
+	STRIP_RESIDENT,
+	STRIP_MISSING
+};
+
+//Fixed point with 16 fractional bits, for sub-pixel scrolling
+const int FIXED_SHIFT = 16;
+const int FIXED_ONE = 1 << FIXED_SHIFT;
+
+//Camera speed, one pixel a frame
+const int CAMERA_VEL = FIXED_ONE;
+
+//Total background layers
+const int TOTAL_LAYERS = 3;
+
 //A circle structure
 struct Circle
 {
@@ -35,6 +63,9 @@ class LTexture
 		//Loads image at specified path
 		bool loadFromFile( std::string path );
 		
+		//Color keys and uploads an already decoded image, the surface stays with the caller
+		bool loadFromSurface( SDL_Surface* surface );
+		
 		#ifdef _SDL_TTF_H
 		//Creates image from font string
 		bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
@@ -138,6 +169,88 @@ class Dot
 };
 
 
+//One layer of a parallax background, streamed in vertical strips
+class ParallaxLayer
+{
+	public:
+		//Initializes variables
+		ParallaxLayer();
+		
+		//Deallocates memory
+		~ParallaxLayer();
+		
+		//Splits the panorama into strip files when they are missing or stale, then starts the loader
+		//The scroll factor is fixed point, FIXED_ONE moves with the camera
+		bool load(std::string path, int scrollFactor);
+		
+		//Moves the layer by the camera's fixed point movement
+		void scroll(int cameraDelta);
+		
+		//Queues the strips in and around the view, uploads decoded ones, evicts the rest and draws the layer
+		void render();
+		
+		//Stops the loader and deallocates the strips
+		void free();
+		
+		//Set alpha modulation
+		void setAlpha(Uint8 alpha);
+		
+	private:
+		//A strip of the panorama
+		struct Strip
+		{
+			//Loading state, guarded by the lock
+			int state;
+			
+			//Pixels decoded by the loader waiting for upload
+			SDL_Surface* surface;
+			
+			//Texture while resident, only touched by the main thread
+			LTexture* texture;
+		};
+		
+		//Gets the file a strip is stored in
+		std::string getStripPath(int strip);
+		
+		//Cuts the panorama into strip files and writes the strip index
+		bool splitPanorama(Uint32 sourceHash);
+		
+		//Queues a strip if it is not loaded or on its way
+		void request(int strip);
+		
+		//Decodes requested strips on the loader thread
+		static int loader(void* data);
+		
+		//Where the panorama and its strips are stored
+		std::string mPath;
+		
+		//Panorama dimensions
+		int mWidth;
+		int mHeight;
+		
+		//Layer speed relative to the camera
+		int mScrollFactor;
+		
+		//Scroll offset, fixed point to keep the sub-pixel part
+		Sint64 mOffset;
+		
+		//Alpha modulation applied to streamed strips
+		Uint8 mAlpha;
+		
+		//The strips
+		std::vector<Strip> mStrips;
+		
+		//Loader thread and its request queue
+		SDL_Thread* mThread;
+		SDL_mutex* mLock;
+		SDL_cond* mWake;
+		std::deque<int> mRequests;
+		bool mQuit;
+};
+
+//Hashes a file's bytes so derived files can tell when it changed, 0 if it can't be read
+Uint32 hashFile(std::string path);
+
 //Starts up SDL and creates window
 bool init();
 
@@ -167,7 +280,9 @@ SDL_Renderer* gRenderer = NULL;
 
 //Scene textures
 LTexture gDotTexture;
-LTexture gBGTexture;
+
+//Background layers, back to front
+ParallaxLayer gLayers[TOTAL_LAYERS];
 
 LTexture::LTexture()
 {
@@ -188,9 +303,6 @@ bool LTexture::loadFromFile( std::string path )
 	//Get rid of preexisting texture
 	free();
 
-	//The final texture
-	SDL_Texture* newTexture = NULL;
-
 	//Load image at specified path
 	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
 	if( loadedSurface == NULL )
@@ -199,20 +311,10 @@ bool LTexture::loadFromFile( std::string path )
 	}
 	else
 	{
-		//Color key image
-		SDL_SetColorKey( loadedSurface, SDL_TRUE, SDL_MapRGB( loadedSurface->format, 0, 0xFF, 0xFF ) );
-
 		//Create texture from surface pixels
-        newTexture = SDL_CreateTextureFromSurface( gRenderer, loadedSurface );
-		if( newTexture == NULL )
-		{
-			printf( "Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
-		}
-		else
+		if( !loadFromSurface( loadedSurface ) )
 		{
-			//Get image dimensions
-			mWidth = loadedSurface->w;
-			mHeight = loadedSurface->h;
+			printf( "Unable to create texture from %s!\n", path.c_str() );
 		}
 
 		//Get rid of old loaded surface
@@ -220,7 +322,30 @@ bool LTexture::loadFromFile( std::string path )
 	}
 
 	//Return success
-	mTexture = newTexture;
+	return mTexture != NULL;
+}
+
+bool LTexture::loadFromSurface( SDL_Surface* surface )
+{
+	//Get rid of preexisting texture
+	free();
+
+	//Color key image
+	SDL_SetColorKey( surface, SDL_TRUE, SDL_MapRGB( surface->format, 0, 0xFF, 0xFF ) );
+
+	//Create texture from surface pixels
+	mTexture = SDL_CreateTextureFromSurface( gRenderer, surface );
+	if( mTexture == NULL )
+	{
+		printf( "Unable to create texture! SDL Error: %s\n", SDL_GetError() );
+	}
+	else
+	{
+		//Get image dimensions
+		mWidth = surface->w;
+		mHeight = surface->h;
+	}
+
 	return mTexture != NULL;
 }
 
@@ -494,6 +619,420 @@ void Dot::shiftColliders()
 	mCollider.y = mPosY;
 }
 
+ParallaxLayer::ParallaxLayer()
+{
+	//Initialize
+	mWidth = 0;
+	mHeight = 0;
+	mScrollFactor = FIXED_ONE;
+	mOffset = 0;
+	mAlpha = 0xFF;
+	mThread = NULL;
+	mLock = NULL;
+	mWake = NULL;
+	mQuit = false;
+}
+
+ParallaxLayer::~ParallaxLayer()
+{
+	//Deallocate
+	free();
+}
+
+bool ParallaxLayer::load(std::string path, int scrollFactor)
+{
+	//Get rid of preexisting strips
+	free();
+	
+	mPath = path;
+	mScrollFactor = scrollFactor;
+	mOffset = 0;
+	
+	//The strips are only valid for the panorama they were cut from
+	Uint32 sourceHash = hashFile(mPath);
+	if(sourceHash == 0)
+	{
+		printf("Unable to read %s! SDL Error: %s\n", mPath.c_str(), SDL_GetError());
+		return false;
+	}
+	
+	//Read the strip index
+	bool split = true;
+	SDL_RWops* file = SDL_RWFromFile((mPath + ".strips").c_str(), "rb");
+	if(file != NULL)
+	{
+		Sint32 width = 0;
+		Sint32 height = 0;
+		Uint32 hash = 0;
+		if(SDL_RWread(file, &width, sizeof(Sint32), 1) == 1 && SDL_RWread(file, &height, sizeof(Sint32), 1) == 1 &&
+			SDL_RWread(file, &hash, sizeof(Uint32), 1) == 1 && hash == sourceHash && width > 0 && height > 0)
+		{
+			mWidth = width;
+			mHeight = height;
+			split = false;
+		}
+		SDL_RWclose(file);
+	}
+	
+	//First run or the panorama changed, cut it up again
+	if(split && !splitPanorama(sourceHash))
+	{
+		return false;
+	}
+	
+	if(mWidth <= 0 || mHeight <= 0)
+	{
+		printf("Strip index for %s is damaged!\n", mPath.c_str());
+		return false;
+	}
+	
+	//Nothing is streamed in yet
+	Strip empty = {STRIP_UNLOADED, NULL, NULL};
+	mStrips.assign((mWidth + STRIP_WIDTH - 1) / STRIP_WIDTH, empty);
+	
+	//Start the loader
+	mQuit = false;
+	mLock = SDL_CreateMutex();
+	mWake = SDL_CreateCond();
+	mThread = SDL_CreateThread(loader, "StripLoader", this);
+	if(mThread == NULL)
+	{
+		printf("Unable to create strip loader! SDL Error: %s\n", SDL_GetError());
+		free();
+		return false;
+	}
+	
+	return true;
+}
+
+bool ParallaxLayer::splitPanorama(Uint32 sourceHash)
+{
+	//Load the whole panorama once
+	SDL_Surface* panorama = IMG_Load(mPath.c_str());
+	if(panorama == NULL)
+	{
+		printf("Unable to load image %s! SDL_image Error: %s\n", mPath.c_str(), IMG_GetError());
+		return false;
+	}
+	
+	//Copy pixels as they are
+	SDL_SetSurfaceBlendMode(panorama, SDL_BLENDMODE_NONE);
+	
+	bool success = true;
+	int totalStrips = (panorama->w + STRIP_WIDTH - 1) / STRIP_WIDTH;
+	for(int i = 0; i < totalStrips && success; ++i)
+	{
+		//Cut out the strip
+		SDL_Rect clip = { i * STRIP_WIDTH, 0, STRIP_WIDTH, panorama->h };
+		if(clip.x + clip.w > panorama->w)
+		{
+			clip.w = panorama->w - clip.x;
+		}
+		SDL_PixelFormat* format = panorama->format;
+		SDL_Surface* strip = SDL_CreateRGBSurface(0, clip.w, clip.h, format->BitsPerPixel, format->Rmask, format->Gmask, format->Bmask, format->Amask);
+		if(strip == NULL)
+		{
+			printf("Unable to create strip surface! SDL Error: %s\n", SDL_GetError());
+			success = false;
+		}
+		else
+		{
+			SDL_BlitSurface(panorama, &clip, strip, NULL);
+			if(IMG_SavePNG(strip, getStripPath(i).c_str()) != 0)
+			{
+				printf("Unable to save strip %s! SDL_image Error: %s\n", getStripPath(i).c_str(), IMG_GetError());
+				success = false;
+			}
+			SDL_FreeSurface(strip);
+		}
+	}
+	
+	if(success)
+	{
+		mWidth = panorama->w;
+		mHeight = panorama->h;
+		
+		//Write the strip index last so a half split panorama gets split again
+		SDL_RWops* file = SDL_RWFromFile((mPath + ".strips").c_str(), "w+b");
+		if(file != NULL)
+		{
+			Sint32 width = mWidth;
+			Sint32 height = mHeight;
+			SDL_RWwrite(file, &width, sizeof(Sint32), 1);
+			SDL_RWwrite(file, &height, sizeof(Sint32), 1);
+			SDL_RWwrite(file, &sourceHash, sizeof(Uint32), 1);
+			SDL_RWclose(file);
+		}
+	}
+	
+	SDL_FreeSurface(panorama);
+	return success;
+}
+
+std::string ParallaxLayer::getStripPath(int strip)
+{
+	std::stringstream path;
+	path << mPath << "." << strip << ".png";
+	return path.str();
+}
+
+void ParallaxLayer::scroll(int cameraDelta)
+{
+	//Move by the camera movement scaled by the layer's factor
+	mOffset += ((Sint64)cameraDelta * mScrollFactor) >> FIXED_SHIFT;
+	
+	//Wrap around the panorama
+	Sint64 width = (Sint64)mWidth << FIXED_SHIFT;
+	if(width > 0)
+	{
+		mOffset %= width;
+		if(mOffset < 0)
+		{
+			mOffset += width;
+		}
+	}
+}
+
+void ParallaxLayer::request(int strip)
+{
+	if(mStrips[strip].state == STRIP_UNLOADED)
+	{
+		mStrips[strip].state = STRIP_QUEUED;
+		mRequests.push_back(strip);
+	}
+}
+
+void ParallaxLayer::render()
+{
+	int totalStrips = (int)mStrips.size();
+	if(totalStrips == 0 || mThread == NULL)
+	{
+		return;
+	}
+	
+	//The panorama pixel at the left edge of the screen
+	int offset = (int)(mOffset >> FIXED_SHIFT);
+	int first = offset / STRIP_WIDTH;
+	
+	//Count the strips in view, the last strip can be narrower than the others
+	int visible = 0;
+	for(int x = first * STRIP_WIDTH - offset, strip = first; x < SCREEN_WIDTH; strip = (strip + 1) % totalStrips)
+	{
+		x += strip == totalStrips - 1 ? mWidth - strip * STRIP_WIDTH : STRIP_WIDTH;
+		++visible;
+	}
+	
+	//The strips in view plus the ones about to scroll in on either side
+	std::vector<bool> wanted(totalStrips, false);
+	for(int i = -STRIP_PREFETCH; i < visible + STRIP_PREFETCH; ++i)
+	{
+		wanted[((first + i) % totalStrips + totalStrips) % totalStrips] = true;
+	}
+	
+	SDL_LockMutex(mLock);
+	
+	//Drop requests that scrolled away so the loader follows the view
+	for(size_t i = 0; i < mRequests.size(); ++i)
+	{
+		if(!wanted[mRequests[i]])
+		{
+			mStrips[mRequests[i]].state = STRIP_UNLOADED;
+		}
+	}
+	std::deque<int> requests;
+	for(size_t i = 0; i < mRequests.size(); ++i)
+	{
+		if(wanted[mRequests[i]])
+		{
+			requests.push_back(mRequests[i]);
+		}
+	}
+	mRequests.swap(requests);
+	
+	//Queue the view first, then what is about to show
+	for(int i = 0; i < visible; ++i)
+	{
+		request((first + i) % totalStrips);
+	}
+	for(int i = 1; i <= STRIP_PREFETCH; ++i)
+	{
+		request((first + visible - 1 + i) % totalStrips);
+		request(((first - i) % totalStrips + totalStrips) % totalStrips);
+	}
+	if(!mRequests.empty())
+	{
+		SDL_CondSignal(mWake);
+	}
+	
+	for(int i = 0; i < totalStrips; ++i)
+	{
+		Strip& strip = mStrips[i];
+		
+		//Upload strips the loader finished, decoding already happened off this thread
+		if(strip.state == STRIP_LOADED)
+		{
+			if(wanted[i])
+			{
+				strip.texture = new LTexture();
+				if(!strip.texture->loadFromSurface(strip.surface))
+				{
+					delete strip.texture;
+					strip.texture = NULL;
+					strip.state = STRIP_MISSING;
+				}
+				else
+				{
+					strip.texture->setAlpha(mAlpha);
+					strip.state = STRIP_RESIDENT;
+				}
+			}
+			else
+			{
+				strip.state = STRIP_UNLOADED;
+			}
+			SDL_FreeSurface(strip.surface);
+			strip.surface = NULL;
+		}
+		//Evict the strips out of view
+		else if(strip.state == STRIP_RESIDENT && !wanted[i])
+		{
+			delete strip.texture;
+			strip.texture = NULL;
+			strip.state = STRIP_UNLOADED;
+		}
+	}
+	
+	SDL_UnlockMutex(mLock);
+	
+	//Draw the resident strips in view, leaving gaps for ones still loading
+	int x = first * STRIP_WIDTH - offset;
+	for(int i = 0, strip = first; i < visible; ++i, strip = (strip + 1) % totalStrips)
+	{
+		if(mStrips[strip].texture != NULL)
+		{
+			mStrips[strip].texture->render(x, 0);
+		}
+		x += strip == totalStrips - 1 ? mWidth - strip * STRIP_WIDTH : STRIP_WIDTH;
+	}
+}
+
+void ParallaxLayer::free()
+{
+	//Stop the loader
+	if(mThread != NULL)
+	{
+		SDL_LockMutex(mLock);
+		mQuit = true;
+		SDL_CondSignal(mWake);
+		SDL_UnlockMutex(mLock);
+		SDL_WaitThread(mThread, NULL);
+		mThread = NULL;
+	}
+	if(mWake != NULL)
+	{
+		SDL_DestroyCond(mWake);
+		mWake = NULL;
+	}
+	if(mLock != NULL)
+	{
+		SDL_DestroyMutex(mLock);
+		mLock = NULL;
+	}
+	
+	//Free the strips
+	for(int i = 0; i < (int)mStrips.size(); ++i)
+	{
+		if(mStrips[i].surface != NULL)
+		{
+			SDL_FreeSurface(mStrips[i].surface);
+		}
+		delete mStrips[i].texture;
+	}
+	mStrips.clear();
+	mRequests.clear();
+	mWidth = 0;
+	mHeight = 0;
+}
+
+void ParallaxLayer::setAlpha(Uint8 alpha)
+{
+	mAlpha = alpha;
+	for(int i = 0; i < (int)mStrips.size(); ++i)
+	{
+		if(mStrips[i].texture != NULL)
+		{
+			mStrips[i].texture->setAlpha(alpha);
+		}
+	}
+}
+
+int ParallaxLayer::loader(void* data)
+{
+	ParallaxLayer* layer = (ParallaxLayer*)data;
+	
+	SDL_LockMutex(layer->mLock);
+	while(!layer->mQuit)
+	{
+		//Sleep until there is work
+		if(layer->mRequests.empty())
+		{
+			SDL_CondWait(layer->mWake, layer->mLock);
+			continue;
+		}
+		int index = layer->mRequests.front();
+		layer->mRequests.pop_front();
+		
+		//Decode the strip without holding the lock
+		SDL_UnlockMutex(layer->mLock);
+		std::string path = layer->getStripPath(index);
+		SDL_Surface* surface = IMG_Load(path.c_str());
+		if(surface == NULL)
+		{
+			printf("Unable to load strip %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+		}
+		SDL_LockMutex(layer->mLock);
+		
+		//Hand it to the main thread for upload, unless it scrolled away and was requeued meanwhile
+		Strip& strip = layer->mStrips[index];
+		if(strip.state == STRIP_QUEUED)
+		{
+			strip.surface = surface;
+			strip.state = surface != NULL ? STRIP_LOADED : STRIP_MISSING;
+		}
+		else if(surface != NULL)
+		{
+			SDL_FreeSurface(surface);
+		}
+	}
+	SDL_UnlockMutex(layer->mLock);
+	
+	return 0;
+}
+
+Uint32 hashFile(std::string path)
+{
+	SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+	if(file == NULL)
+	{
+		return 0;
+	}
+	
+	//FNV-1a over every byte
+	Uint32 hash = 2166136261u;
+	Uint8 buffer[4096];
+	size_t read;
+	while((read = SDL_RWread(file, buffer, 1, sizeof(buffer))) > 0)
+	{
+		for(size_t i = 0; i < read; ++i)
+		{
+			hash = (hash ^ buffer[i]) * 16777619u;
+		}
+	}
+	SDL_RWclose(file);
+	
+	//Keep 0 for unreadable files
+	return hash != 0 ? hash : 1;
+}
 
 bool init()
 {
@@ -576,10 +1115,18 @@ bool loadMedia()
 		success = false;
 	}
 	
-	if(!gBGTexture.loadFromFile("bg.png"))
+	//Only bg.png ships with the lesson, so every layer streams it at its own speed
+	//and the nearer ones are drawn see-through on top
+	const int scrollFactors[TOTAL_LAYERS] = { FIXED_ONE / 4, FIXED_ONE / 2, FIXED_ONE };
+	const Uint8 alphas[TOTAL_LAYERS] = { 0xFF, 0x80, 0x40 };
+	for(int i = 0; i < TOTAL_LAYERS; ++i)
 	{
-		printf("Failed to load background texture! SDL Error: %s\n", SDL_GetError());
-		success = false;
+		if(!gLayers[i].load("bg.png", scrollFactors[i]))
+		{
+			printf("Failed to load background layer %d!\n", i);
+			success = false;
+		}
+		gLayers[i].setAlpha(alphas[i]);
 	}
 	
 	return success;
@@ -590,7 +1137,11 @@ void close()
 	//Free loaded images
 	gDotTexture.free();
 
-	gBGTexture.free();
+	//Free background layers
+	for(int i = 0; i < TOTAL_LAYERS; ++i)
+	{
+		gLayers[i].free();
+	}
 	
 	/*
 	//Free global font
@@ -703,9 +1254,6 @@ int wmain( int argc, char* args[] )
 			//The dot that will be moving around the screen
 			Dot dot;
 			
-			//The background scrolling offset
-			int scrollingOffset = 0;
-			
 			//While application is running
 			while(!quit)
 			{
@@ -725,20 +1273,21 @@ int wmain( int argc, char* args[] )
 				//Move the dot
 				dot.move();
 				
-				//Scroll background
-				--scrollingOffset;
-				if(scrollingOffset < -gBGTexture.getWidth())
+				//Scroll background layers
+				for(int i = 0; i < TOTAL_LAYERS; ++i)
 				{
-					scrollingOffset = 0;
+					gLayers[i].scroll(CAMERA_VEL);
 				}
 
 				//Clear screen
 				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 				SDL_RenderClear(gRenderer);
 				
-				//Render background
-				gBGTexture.render(scrollingOffset, 0);
-				gBGTexture.render(scrollingOffset + gBGTexture.getWidth(), 0);
+				//Render background layers back to front
+				for(int i = 0; i < TOTAL_LAYERS; ++i)
+				{
+					gLayers[i].render();
+				}
 				
 				//Render dots
 				dot.render();
@@ -9,6 +9,12 @@
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
+
+//Longest time to block waiting for events when there is nothing to draw
+const int IDLE_TIMEOUT = 1000;
+
+//Milliseconds between caret blinks
+const int CARET_BLINK_INTERVAL = 500;
 const int TOTAL_DATA = 10;
 
 //The dimensions of the level
@@ -40,6 +46,12 @@ class LTexture
 		bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
 		#endif
 
+		//Creates blank texture
+		bool createBlank(int width, int height, SDL_TextureAccess access = SDL_TEXTUREACCESS_TARGET);
+
+		//Set self as render target
+		void setAsRenderTarget();
+
 		//Deallocates texture
 		void free();
 
@@ -138,6 +150,46 @@ class Dot
 };
 
 
+//Opaque static content cached in a render target and only recomposed when invalidated
+class LLayer
+{
+	public:
+		//Initializes variables
+		LLayer();
+
+		//Creates the layer target
+		bool create(int width, int height);
+
+		//Deallocates the target
+		void free();
+
+		//Marks the layer to be recomposed
+		void invalidate();
+
+		//Checks whether the layer needs recomposing
+		bool isDirty();
+
+		//Directs rendering into the layer cleared to white
+		void begin();
+
+		//Directs rendering back to the window and marks the layer clean
+		void end();
+
+		//Composites the layer at given point
+		void render(int x, int y);
+
+		//Gets layer dimensions
+		int getWidth();
+		int getHeight();
+
+	private:
+		//The cached content
+		LTexture mTarget;
+
+		//Whether the content is out of date
+		bool mDirty;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -156,6 +208,9 @@ bool checkCollision(Circle& a, SDL_Rect& b);
 //Calculates distance squared between two points
 double distanceSquared(int x1, int y1, int x2, int y2);
 
+//Timer callback that wakes the main loop to blink the caret
+Uint32 blinkCaret(Uint32 interval, void* param);
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -169,6 +224,9 @@ SDL_Renderer* gRenderer = NULL;
 LTexture gInputTextTexture;
 LTexture gPromptTextTexture;
 
+//Cached text layer
+LLayer gTextLayer;
+
 TTF_Font* gFont = NULL;
 
 //Data points
@@ -266,6 +324,32 @@ bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColo
 }
 #endif
 
+bool LTexture::createBlank(int width, int height, SDL_TextureAccess access)
+{
+	//Get rid of pre-existing texture
+	free();
+
+	//Create uninitialized texture
+	mTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA8888, access, width, height);
+	if(mTexture == NULL)
+	{
+		printf("Unable to create blank texture! SDL Error: %s\n", SDL_GetError());
+	}
+	else
+	{
+		mWidth = width;
+		mHeight = height;
+	}
+
+	return mTexture != NULL;
+}
+
+void LTexture::setAsRenderTarget()
+{
+	//Make self render target
+	SDL_SetRenderTarget(gRenderer, mTexture);
+}
+
 void LTexture::free()
 {
 	//Free texture if it exists
@@ -500,13 +584,79 @@ void Dot::shiftColliders()
 }
 
 
+LLayer::LLayer()
+{
+	//Nothing composed yet
+	mDirty = true;
+}
+
+bool LLayer::create(int width, int height)
+{
+	//Needs composing after any resize
+	mDirty = true;
+	if(!mTarget.createBlank(width, height, SDL_TEXTUREACCESS_TARGET))
+	{
+		return false;
+	}
+
+	//Opaque layers are copied straight over the screen
+	mTarget.setBlendMode(SDL_BLENDMODE_NONE);
+	return true;
+}
+
+void LLayer::free()
+{
+	mTarget.free();
+	mDirty = true;
+}
+
+void LLayer::invalidate()
+{
+	mDirty = true;
+}
+
+bool LLayer::isDirty()
+{
+	return mDirty;
+}
+
+void LLayer::begin()
+{
+	//Compose into the layer over a white background
+	mTarget.setAsRenderTarget();
+	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_RenderClear(gRenderer);
+}
+
+void LLayer::end()
+{
+	//Back to the window
+	SDL_SetRenderTarget(gRenderer, NULL);
+	mDirty = false;
+}
+
+void LLayer::render(int x, int y)
+{
+	mTarget.render(x, y);
+}
+
+int LLayer::getWidth()
+{
+	return mTarget.getWidth();
+}
+
+int LLayer::getHeight()
+{
+	return mTarget.getHeight();
+}
+
 bool init()
 {
 	//Initialization flag
 	bool success = true;
 
 	//Initialize SDL
-	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
+	if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_TIMER ) < 0 )
 	{
 		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
 		success = false;
@@ -529,7 +679,7 @@ bool init()
 		else
 		{
 			//Create vsynced renderer for window
-			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 			if( gRenderer == NULL )
 			{
 				printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -597,6 +747,13 @@ bool loadMedia()
 		}
 	}
 
+
+	//Create the text layer
+	if(!gTextLayer.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+	{
+		printf("Failed to create text layer!\n");
+		success = false;
+	}
 	
 	return success;
 }
@@ -605,6 +762,7 @@ void close()
 {
 	//Free loaded images
 	//gDotTexture.free();
+	gTextLayer.free();
 
 	//Free global font
 	TTF_CloseFont( gFont );
@@ -691,6 +849,18 @@ double distanceSquared(int x1, int y1, int x2, int y2)
 	return deltaX * deltaX + deltaY * deltaY;
 }
 
+Uint32 blinkCaret(Uint32 interval, void*)
+{
+	//Wake the main loop with a user event
+	SDL_Event event;
+	SDL_zero(event);
+	event.type = SDL_USEREVENT;
+	SDL_PushEvent(&event);
+
+	//Keep blinking
+	return interval;
+}
+
 int wmain( int argc, char* args[] )
 {
 	//Start up SDL and create window
@@ -720,6 +890,13 @@ int wmain( int argc, char* args[] )
 			std::string inputText = "Some Text";
 			gInputTextTexture.loadFromRenderedText(inputText.c_str(), textColor);
 			
+			//Whether the screen needs presenting
+			bool present = true;
+			
+			//Caret blink state
+			bool caretVisible = true;
+			SDL_TimerID caretTimer = SDL_AddTimer(CARET_BLINK_INTERVAL, blinkCaret, NULL);
+			
 			//Enable text input
 			SDL_StartTextInput();
 			
@@ -729,14 +906,35 @@ int wmain( int argc, char* args[] )
 				//The reremder text flag
 				bool renderText = false;
 				
+				//Block until something happens unless there is drawing left to do
+				int timeout = (present || gTextLayer.isDirty()) ? 0 : IDLE_TIMEOUT;
+				bool hasEvent = SDL_WaitEventTimeout(&e, timeout) != 0;
+				
 				//Handle events on queue
-				while(SDL_PollEvent(&e) != 0)
+				for(; hasEvent; hasEvent = SDL_PollEvent(&e) != 0)
 				{
 					//User requests quit
 					if(e.type == SDL_QUIT)
 					{
 						quit = true;
 					}
+					//Window contents were lost
+					else if(e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED)
+					{
+						present = true;
+					}
+					//The device was reset and every render target lost its contents
+					else if(e.type == SDL_RENDER_TARGETS_RESET)
+					{
+						gTextLayer.invalidate();
+						present = true;
+					}
+					//Caret timer fired
+					else if(e.type == SDL_USEREVENT)
+					{
+						caretVisible = !caretVisible;
+						present = true;
+					}
 					//Special key input
 					else if(e.type == SDL_KEYDOWN)
 					{
@@ -790,22 +988,50 @@ int wmain( int argc, char* args[] )
 						//Render space texture
 						gInputTextTexture.loadFromRenderedText(" ", textColor);
 					}
+					
+					//Text changed
+					gTextLayer.invalidate();
+				}
+
+				//Compose text only when it changed
+				if(gTextLayer.isDirty())
+				{
+					gTextLayer.begin();
+					gPromptTextTexture.render((SCREEN_WIDTH - gPromptTextTexture.getWidth())/2,
+						0);
+					gInputTextTexture.render((SCREEN_WIDTH - gInputTextTexture.getWidth())/2,
+						gPromptTextTexture.getHeight());
+					gTextLayer.end();
+					present = true;
 				}
 		
-				//Clear screen
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-				SDL_RenderClear(gRenderer);
-				
-				//Render text textures
-				gPromptTextTexture.render((SCREEN_WIDTH - gPromptTextTexture.getWidth())/2,
-					0);
-				gInputTextTexture.render((SCREEN_WIDTH - gInputTextTexture.getWidth())/2,
-					gPromptTextTexture.getHeight());
-				
-				//Update screen
-				SDL_RenderPresent(gRenderer);
+				//Only present when something changed
+				if(present)
+				{
+					//Clear screen
+					SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+					SDL_RenderClear(gRenderer);
+					
+					//Render cached text
+					gTextLayer.render(0, 0);
+					
+					//Render caret after the input text
+					if(caretVisible)
+					{
+						SDL_Rect caret = {(SCREEN_WIDTH + gInputTextTexture.getWidth())/2, gPromptTextTexture.getHeight(), 2, gInputTextTexture.getHeight()};
+						SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0xFF);
+						SDL_RenderFillRect(gRenderer, &caret);
+					}
+					
+					//Update screen
+					SDL_RenderPresent(gRenderer);
+					present = false;
+				}
 			}
 			
+			//Stop blinking
+			SDL_RemoveTimer(caretTimer);
+			
 			//Disable text input
 			SDL_StopTextInput();
 		}
@@ -10,6 +10,9 @@
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Longest time to block waiting for events when there is nothing to draw
+const int IDLE_TIMEOUT = 1000;
+
 //The dimensions of the level
 const int LEVEL_WIDTH = SCREEN_WIDTH;
 const int LEVEL_HEIGHT = SCREEN_HEIGHT;
@@ -41,6 +44,12 @@ class LTexture
 		bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
 		#endif
 
+		//Creates blank texture
+		bool createBlank(int width, int height, SDL_TextureAccess access = SDL_TEXTUREACCESS_TARGET);
+
+		//Set self as render target
+		void setAsRenderTarget();
+
 		//Deallocates texture
 		void free();
 
@@ -139,6 +148,46 @@ class Dot
 };
 
 
+//Opaque static content cached in a render target and only recomposed when invalidated
+class LLayer
+{
+	public:
+		//Initializes variables
+		LLayer();
+
+		//Creates the layer target
+		bool create(int width, int height);
+
+		//Deallocates the target
+		void free();
+
+		//Marks the layer to be recomposed
+		void invalidate();
+
+		//Checks whether the layer needs recomposing
+		bool isDirty();
+
+		//Directs rendering into the layer cleared to white
+		void begin();
+
+		//Directs rendering back to the window and marks the layer clean
+		void end();
+
+		//Composites the layer at given point
+		void render(int x, int y);
+
+		//Gets layer dimensions
+		int getWidth();
+		int getHeight();
+
+	private:
+		//The cached content
+		LTexture mTarget;
+
+		//Whether the content is out of date
+		bool mDirty;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -171,6 +220,9 @@ LTexture gInputTextTexture;
 LTexture gPromptTextTexture;
 LTexture gDataTextures[TOTAL_DATA];
 
+//Cached text layer
+LLayer gTextLayer;
+
 //Data points
 Sint32 gData[TOTAL_DATA];
 
@@ -266,6 +318,32 @@ bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColo
 }
 #endif
 
+bool LTexture::createBlank(int width, int height, SDL_TextureAccess access)
+{
+	//Get rid of pre-existing texture
+	free();
+
+	//Create uninitialized texture
+	mTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA8888, access, width, height);
+	if(mTexture == NULL)
+	{
+		printf("Unable to create blank texture! SDL Error: %s\n", SDL_GetError());
+	}
+	else
+	{
+		mWidth = width;
+		mHeight = height;
+	}
+
+	return mTexture != NULL;
+}
+
+void LTexture::setAsRenderTarget()
+{
+	//Make self render target
+	SDL_SetRenderTarget(gRenderer, mTexture);
+}
+
 void LTexture::free()
 {
 	//Free texture if it exists
@@ -500,6 +578,72 @@ void Dot::shiftColliders()
 }
 
 
+LLayer::LLayer()
+{
+	//Nothing composed yet
+	mDirty = true;
+}
+
+bool LLayer::create(int width, int height)
+{
+	//Needs composing after any resize
+	mDirty = true;
+	if(!mTarget.createBlank(width, height, SDL_TEXTUREACCESS_TARGET))
+	{
+		return false;
+	}
+
+	//Opaque layers are copied straight over the screen
+	mTarget.setBlendMode(SDL_BLENDMODE_NONE);
+	return true;
+}
+
+void LLayer::free()
+{
+	mTarget.free();
+	mDirty = true;
+}
+
+void LLayer::invalidate()
+{
+	mDirty = true;
+}
+
+bool LLayer::isDirty()
+{
+	return mDirty;
+}
+
+void LLayer::begin()
+{
+	//Compose into the layer over a white background
+	mTarget.setAsRenderTarget();
+	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_RenderClear(gRenderer);
+}
+
+void LLayer::end()
+{
+	//Back to the window
+	SDL_SetRenderTarget(gRenderer, NULL);
+	mDirty = false;
+}
+
+void LLayer::render(int x, int y)
+{
+	mTarget.render(x, y);
+}
+
+int LLayer::getWidth()
+{
+	return mTarget.getWidth();
+}
+
+int LLayer::getHeight()
+{
+	return mTarget.getHeight();
+}
+
 bool init()
 {
 	//Initialization flag
@@ -529,7 +673,7 @@ bool init()
 		else
 		{
 			//Create vsynced renderer for window
-			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 			if( gRenderer == NULL )
 			{
 				printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -627,6 +771,13 @@ bool loadMedia()
 	{
 		gDataTextures[i].loadFromRenderedText(std::to_string((_Longlong)gData[i]), textColor);
 	}
+
+	//Create the text layer
+	if(!gTextLayer.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+	{
+		printf("Failed to create text layer!\n");
+		success = false;
+	}
 	
 	return success;
 }
@@ -651,6 +802,9 @@ void close()
 		printf("Error: Unable to save file! %s\n", SDL_GetError());
 	}
 
+	//Free cached layer
+	gTextLayer.free();
+
 	//Free global font
 	TTF_CloseFont( gFont );
 	gFont = NULL;
@@ -764,6 +918,9 @@ int wmain( int argc, char* args[] )
 			
 			//Current input point
 			int currentData = 0;
+
+			//Whether the screen needs presenting
+			bool present = true;
 			
 			//While application is running
 			while(!quit)
@@ -771,14 +928,29 @@ int wmain( int argc, char* args[] )
 				//The reremder text flag
 				bool renderText = false;
 				
+				//Block until something happens unless there is drawing left to do
+				int timeout = (present || gTextLayer.isDirty()) ? 0 : IDLE_TIMEOUT;
+				bool hasEvent = SDL_WaitEventTimeout(&e, timeout) != 0;
+				
 				//Handle events on queue
-				while(SDL_PollEvent(&e) != 0)
+				for(; hasEvent; hasEvent = SDL_PollEvent(&e) != 0)
 				{
 					//User requests quit
 					if(e.type == SDL_QUIT)
 					{
 						quit = true;
 					}
+					//Window contents were lost
+					else if(e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED)
+					{
+						present = true;
+					}
+					//The device was reset and every render target lost its contents
+					else if(e.type == SDL_RENDER_TARGETS_RESET)
+					{
+						gTextLayer.invalidate();
+						present = true;
+					}
 					//Special key input
 					else if(e.type == SDL_KEYDOWN)
 					{
@@ -830,23 +1002,40 @@ int wmain( int argc, char* args[] )
 								highlightColor);
 							break;
 						}
+						
+						//Data may have changed
+						gTextLayer.invalidate();
 					}					
 				}
 		
-				//Clear screen
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-				SDL_RenderClear(gRenderer);
-				
-				//Render text textures
-				gPromptTextTexture.render((SCREEN_WIDTH - gPromptTextTexture.getWidth())/2, 0);
-				for(int i = 0; i < TOTAL_DATA; ++i)
+				//Compose text only when it changed
+				if(gTextLayer.isDirty())
 				{
-					gDataTextures[i].render((SCREEN_WIDTH - gDataTextures[i].getWidth())/2, 
-						gPromptTextTexture.getHeight() + gDataTextures[0].getHeight() * i);
+					gTextLayer.begin();
+					gPromptTextTexture.render((SCREEN_WIDTH - gPromptTextTexture.getWidth())/2, 0);
+					for(int i = 0; i < TOTAL_DATA; ++i)
+					{
+						gDataTextures[i].render((SCREEN_WIDTH - gDataTextures[i].getWidth())/2, 
+							gPromptTextTexture.getHeight() + gDataTextures[0].getHeight() * i);
+					}
+					gTextLayer.end();
+					present = true;
+				}
+
+				//Only present when something changed
+				if(present)
+				{
+					//Clear screen
+					SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+					SDL_RenderClear(gRenderer);
+					
+					//Render cached text
+					gTextLayer.render(0, 0);
+					
+					//Update screen
+					SDL_RenderPresent(gRenderer);
+					present = false;
 				}
-				
-				//Update screen
-				SDL_RenderPresent(gRenderer);
 			}
 			
 		}
@@ -10,6 +10,29 @@
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Longest wait for events when there is nothing new to present, input, exposes and restores end it early
+const Uint32 IDLE_TIMEOUT = 1000;
+
+//Milliseconds the window size must hold before render targets are rebuilt
+const Uint32 RESIZE_SETTLE_TIME = 200;
+
+//Fractions of the window resolution the scene can be rendered at
+const float RENDER_SCALES[] = { 1.0f, 0.75f, 0.5f };
+const int TOTAL_RENDER_SCALES = 3;
+
+//How much the window is throttled
+enum LWindowActivity
+{
+	WINDOW_ACTIVITY_FOCUSED = 0,
+	WINDOW_ACTIVITY_BACKGROUND = 1,
+	WINDOW_ACTIVITY_HIDDEN = 2,
+	WINDOW_ACTIVITY_TOTAL = 3
+};
+
+//Milliseconds between ticks at each activity, focused windows present as soon as
+//something changes and hidden windows never draw but still wake the loop for updates
+const Uint32 ACTIVITY_TICK_INTERVAL[WINDOW_ACTIVITY_TOTAL] = { 0, 100, 250 };
+
 //The dimensions of the level
 const int LEVEL_WIDTH = SCREEN_WIDTH;
 const int LEVEL_HEIGHT = SCREEN_HEIGHT;
@@ -41,6 +64,15 @@ class LTexture
 		bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
 		#endif
 
+		//Creates blank texture
+		bool createBlank(int width, int height, SDL_TextureAccess access = SDL_TEXTUREACCESS_TARGET);
+
+		//Set self as render target
+		void setAsRenderTarget();
+
+		//Renders texture stretched over given area
+		void renderStretched( SDL_Rect* destination );
+
 		//Deallocates texture
 		void free();
 
@@ -165,6 +197,9 @@ class LWindow
 		bool hasKeyboardFocus();
 		bool isMinimized();
 		
+		//Gets how much the window is throttled
+		LWindowActivity getActivity();
+		
 	private:
 		//Window Data
 		SDL_Window* mWindow;
@@ -180,6 +215,112 @@ class LWindow
 		bool mMinimized;	
 };
 
+//Opaque static content cached in a render target and only recomposed when invalidated
+class LLayer
+{
+	public:
+		//Initializes variables
+		LLayer();
+
+		//Creates the layer target
+		bool create(int width, int height);
+
+		//Deallocates the target
+		void free();
+
+		//Marks the layer to be recomposed
+		void invalidate();
+
+		//Checks whether the layer needs recomposing
+		bool isDirty();
+
+		//Directs rendering into the layer cleared to white
+		void begin();
+
+		//Directs rendering back to the window and marks the layer clean
+		void end();
+
+		//Composites the layer at given point
+		void render(int x, int y);
+
+		//Composites the layer stretched over given area
+		void render(SDL_Rect* destination);
+
+		//Gets layer dimensions
+		int getWidth();
+		int getHeight();
+
+	private:
+		//The cached content
+		LTexture mTarget;
+
+		//Whether the content is out of date
+		bool mDirty;
+};
+
+//Maps a fixed logical layout onto a resizable window through a render target
+class LResolution
+{
+	public:
+		//Initializes variables
+		LResolution();
+		
+		//Sets the layout size and the starting window size
+		void init(int logicalWidth, int logicalHeight, int windowWidth, int windowHeight);
+		
+		//Tracks a window size change, the target is rebuilt once resizing settles
+		void resize(int windowWidth, int windowHeight);
+		
+		//Switches to the next render scale
+		void nextRenderScale();
+		
+		//Returns true once when the render target needs rebuilding
+		bool update();
+		
+		//Gets how long the loop may wait before a pending resize settles, at most the given wait
+		Uint32 getSettleDelay(Uint32 wait);
+		
+		//Maps logical coordinates onto the bound render target
+		void beginLogical(SDL_Renderer* renderer);
+		
+		//Restores pixel coordinates
+		void endLogical(SDL_Renderer* renderer);
+		
+		//Gets layout dimensions
+		int getLogicalWidth();
+		int getLogicalHeight();
+		
+		//Gets render target dimensions
+		int getTargetWidth();
+		int getTargetHeight();
+		
+		//Gets the letterboxed window area the target is shown in
+		SDL_Rect getOutputRect();
+		
+	private:
+		//Layout dimensions
+		int mLogicalWidth;
+		int mLogicalHeight;
+		
+		//Window area the layout is scaled into
+		SDL_Rect mOutput;
+		
+		//Render target dimensions
+		int mTargetWidth;
+		int mTargetHeight;
+		
+		//Current entry in RENDER_SCALES
+		int mScaleIndex;
+		
+		//Resize bookkeeping
+		bool mResizePending;
+		Uint32 mResizeTime;
+		bool mTargetStale;
+		
+		//Recalculates the target size for the current output area
+		void updateTargetSize();
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -218,6 +359,18 @@ SDL_Renderer* gRenderer = NULL;
 //Scene textures
 LTexture gSceneTexture;
 
+//Cached scene layer, rendered at the layout resolution
+LLayer gSceneLayer;
+
+//Maps the layout onto the window
+LResolution gResolution;
+
+//Loop activity counters
+Uint32 gTicks[WINDOW_ACTIVITY_TOTAL];
+Uint32 gFrames[WINDOW_ACTIVITY_TOTAL];
+Uint32 gBusyTicks = 0;
+Uint32 gIdleTicks = 0;
+
 LTexture::LTexture()
 {
 	//Initialize
@@ -310,6 +463,32 @@ bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColo
 }
 #endif
 
+bool LTexture::createBlank(int width, int height, SDL_TextureAccess access)
+{
+	//Get rid of pre-existing texture
+	free();
+
+	//Create uninitialized texture
+	mTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA8888, access, width, height);
+	if(mTexture == NULL)
+	{
+		printf("Unable to create blank texture! SDL Error: %s\n", SDL_GetError());
+	}
+	else
+	{
+		mWidth = width;
+		mHeight = height;
+	}
+
+	return mTexture != NULL;
+}
+
+void LTexture::setAsRenderTarget()
+{
+	//Make self render target
+	SDL_SetRenderTarget(gRenderer, mTexture);
+}
+
 void LTexture::free()
 {
 	//Free texture if it exists
@@ -356,6 +535,12 @@ void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* ce
 	SDL_RenderCopyEx( gRenderer, mTexture, clip, &renderQuad, angle, center, flip );
 }
 
+void LTexture::renderStretched( SDL_Rect* destination )
+{
+	//Let the renderer scale the whole texture
+	SDL_RenderCopy( gRenderer, mTexture, NULL, destination );
+}
+
 int LTexture::getWidth()
 {
 	return mWidth;
@@ -573,7 +758,7 @@ bool LWindow::init()
 
 SDL_Renderer* LWindow::createRenderer()
 {
-	return SDL_CreateRenderer(mWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	return SDL_CreateRenderer(mWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 }
 
 void LWindow::handleEvent(SDL_Event& e)
@@ -585,16 +770,10 @@ void LWindow::handleEvent(SDL_Event& e)
 		bool updateCaption = false;
 		switch(e.window.event)
 		{
-			//Get new dimensions and repaint on window size change
+			//Get new dimensions on window size change, the main loop repaints
 			case SDL_WINDOWEVENT_SIZE_CHANGED:
 				mWidth = e.window.data1;
 				mHeight = e.window.data2;
-				SDL_RenderPresent(gRenderer);
-				break;
-				
-			//Repaint on exposure
-			case SDL_WINDOWEVENT_EXPOSED:
-				SDL_RenderPresent(gRenderer);
 				break;
 			
 			//Mouse entered window
@@ -688,6 +867,16 @@ bool LWindow::isMinimized()
 	return mMinimized;
 }
 
+LWindowActivity LWindow::getActivity()
+{
+	if(mMinimized)
+	{
+		return WINDOW_ACTIVITY_HIDDEN;
+	}
+	
+	return mKeyboardFocus ? WINDOW_ACTIVITY_FOCUSED : WINDOW_ACTIVITY_BACKGROUND;
+}
+
 void LWindow::free()
 {
 	if( mWindow != NULL )
@@ -701,6 +890,216 @@ void LWindow::free()
 	mHeight = 0;
 }
 
+LLayer::LLayer()
+{
+	//Nothing composed yet
+	mDirty = true;
+}
+
+bool LLayer::create(int width, int height)
+{
+	//Needs composing after any resize
+	mDirty = true;
+	if(!mTarget.createBlank(width, height, SDL_TEXTUREACCESS_TARGET))
+	{
+		return false;
+	}
+
+	//Opaque layers are copied straight over the screen
+	mTarget.setBlendMode(SDL_BLENDMODE_NONE);
+	return true;
+}
+
+void LLayer::free()
+{
+	mTarget.free();
+	mDirty = true;
+}
+
+void LLayer::invalidate()
+{
+	mDirty = true;
+}
+
+bool LLayer::isDirty()
+{
+	return mDirty;
+}
+
+void LLayer::begin()
+{
+	//Compose into the layer over a white background
+	mTarget.setAsRenderTarget();
+	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_RenderClear(gRenderer);
+}
+
+void LLayer::end()
+{
+	//Back to the window
+	SDL_SetRenderTarget(gRenderer, NULL);
+	mDirty = false;
+}
+
+void LLayer::render(int x, int y)
+{
+	mTarget.render(x, y);
+}
+
+void LLayer::render(SDL_Rect* destination)
+{
+	mTarget.renderStretched(destination);
+}
+
+int LLayer::getWidth()
+{
+	return mTarget.getWidth();
+}
+
+int LLayer::getHeight()
+{
+	return mTarget.getHeight();
+}
+
+LResolution::LResolution()
+{
+	//Initialize
+	mLogicalWidth = 0;
+	mLogicalHeight = 0;
+	mOutput.x = 0;
+	mOutput.y = 0;
+	mOutput.w = 0;
+	mOutput.h = 0;
+	mTargetWidth = 0;
+	mTargetHeight = 0;
+	mScaleIndex = 0;
+	mResizePending = false;
+	mResizeTime = 0;
+	mTargetStale = false;
+}
+
+void LResolution::init(int logicalWidth, int logicalHeight, int windowWidth, int windowHeight)
+{
+	mLogicalWidth = logicalWidth;
+	mLogicalHeight = logicalHeight;
+	resize(windowWidth, windowHeight);
+	
+	//No need to wait for the first target
+	mResizePending = false;
+	updateTargetSize();
+}
+
+void LResolution::resize(int windowWidth, int windowHeight)
+{
+	//Fit the largest area with the layout's aspect ratio
+	if(windowWidth * mLogicalHeight > windowHeight * mLogicalWidth)
+	{
+		mOutput.h = windowHeight;
+		mOutput.w = windowHeight * mLogicalWidth / mLogicalHeight;
+	}
+	else
+	{
+		mOutput.w = windowWidth;
+		mOutput.h = windowWidth * mLogicalHeight / mLogicalWidth;
+	}
+	mOutput.x = (windowWidth - mOutput.w) / 2;
+	mOutput.y = (windowHeight - mOutput.h) / 2;
+	
+	//The old target is stretched over the new area until resizing stops
+	mResizePending = true;
+	mResizeTime = SDL_GetTicks();
+}
+
+void LResolution::nextRenderScale()
+{
+	//Scale changes are applied straight away
+	mScaleIndex = (mScaleIndex + 1) % TOTAL_RENDER_SCALES;
+	updateTargetSize();
+}
+
+bool LResolution::update()
+{
+	//Wait until the window size has held for a while
+	if(mResizePending && SDL_GetTicks() - mResizeTime >= RESIZE_SETTLE_TIME)
+	{
+		mResizePending = false;
+		updateTargetSize();
+	}
+	
+	bool stale = mTargetStale;
+	mTargetStale = false;
+	return stale;
+}
+
+Uint32 LResolution::getSettleDelay(Uint32 wait)
+{
+	if(!mResizePending)
+	{
+		return wait;
+	}
+	
+	Uint32 elapsed = SDL_GetTicks() - mResizeTime;
+	return elapsed >= RESIZE_SETTLE_TIME ? 0 : SDL_min(wait, RESIZE_SETTLE_TIME - elapsed);
+}
+
+void LResolution::beginLogical(SDL_Renderer* renderer)
+{
+	SDL_RenderSetScale(renderer, (float)mTargetWidth / mLogicalWidth, (float)mTargetHeight / mLogicalHeight);
+}
+
+void LResolution::endLogical(SDL_Renderer* renderer)
+{
+	SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+}
+
+int LResolution::getLogicalWidth()
+{
+	return mLogicalWidth;
+}
+
+int LResolution::getLogicalHeight()
+{
+	return mLogicalHeight;
+}
+
+int LResolution::getTargetWidth()
+{
+	return mTargetWidth;
+}
+
+int LResolution::getTargetHeight()
+{
+	return mTargetHeight;
+}
+
+SDL_Rect LResolution::getOutputRect()
+{
+	return mOutput;
+}
+
+void LResolution::updateTargetSize()
+{
+	//Render below the output resolution and let the copy to the window upscale
+	int width = (int)(mOutput.w * RENDER_SCALES[mScaleIndex]);
+	int height = (int)(mOutput.h * RENDER_SCALES[mScaleIndex]);
+	if(width < 1)
+	{
+		width = 1;
+	}
+	if(height < 1)
+	{
+		height = 1;
+	}
+	
+	//Only rebuild when the size actually changed
+	if(width != mTargetWidth || height != mTargetHeight)
+	{
+		mTargetWidth = width;
+		mTargetHeight = height;
+		mTargetStale = true;
+	}
+}
+
 bool init()
 {
 	//Initialization flag
@@ -740,6 +1139,9 @@ bool init()
 				//Initialize renderer color
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 
+				//Lay the scene out at the starting window size
+				gResolution.init( SCREEN_WIDTH, SCREEN_HEIGHT, gWindow.getWidth(), gWindow.getHeight() );
+
 				//Initialize PNG loading
 				int imgFlags = IMG_INIT_PNG;
 				if( !( IMG_Init( imgFlags ) & imgFlags ) )
@@ -778,8 +1180,16 @@ bool loadMedia()
 
 void close()
 {
+	//Report how much work the throttling saved
+	printf("Ticks: %u focused, %u background, %u hidden\n", gTicks[WINDOW_ACTIVITY_FOCUSED], gTicks[WINDOW_ACTIVITY_BACKGROUND], 
+		gTicks[WINDOW_ACTIVITY_HIDDEN]);
+	printf("Frames: %u focused, %u background\n", gFrames[WINDOW_ACTIVITY_FOCUSED], gFrames[WINDOW_ACTIVITY_BACKGROUND]);
+	printf("%u ms busy, %u ms waiting\n", gBusyTicks, gIdleTicks);
+	
+
 	//FreeLoaded imagesize
 	gSceneTexture.free();
+	gSceneLayer.free();
 	
 	//Free global font
 	TTF_CloseFont( gFont );
@@ -892,37 +1302,117 @@ int wmain( int argc, char* args[] )
 			
 			//Current input point
 			int currentData = 0;
+
+			//Whether the screen needs presenting
+			bool present = true;
+			
+			//Milliseconds to wait for events before the next pass
+			Uint32 delay = 0;
+			
+			//Times waiting and working for the activity counters
+			LTimer idleTimer;
+			LTimer busyTimer;
 			
 			//While application is running
 			while(!quit)
 			{
+				//Sleep until an event arrives or the throttled tick is due
+				idleTimer.start();
+				bool hasEvent = SDL_WaitEventTimeout(&e, delay) != 0;
+				gIdleTicks += idleTimer.getTicks();
+				
+				//Time the work done this pass
+				busyTimer.start();
+				
 				//Handle events on queue
-				while(SDL_PollEvent(&e) != 0)
+				for(; hasEvent; hasEvent = SDL_PollEvent(&e) != 0)
 				{
 					//User requests quit
 					if(e.type == SDL_QUIT)
 					{
 						quit = true;
 					}
+					//Repaint when the window contents were lost
+					else if(e.type == SDL_WINDOWEVENT && (e.window.event == SDL_WINDOWEVENT_EXPOSED ||
+						e.window.event == SDL_WINDOWEVENT_RESTORED))
+					{
+						present = true;
+					}
+					//The device was reset and every render target lost its contents
+					else if(e.type == SDL_RENDER_TARGETS_RESET)
+					{
+						gSceneLayer.invalidate();
+						present = true;
+					}
 					
 					//Handle window events
 					gWindow.handleEvent(e);			
+					
+					//Stretch the current scene over the new size, one present covers the whole burst
+					if(e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+					{
+						gResolution.resize(e.window.data1, e.window.data2);
+						present = true;
+					}
+					//Cycle the render resolution on r
+					else if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_r)
+					{
+						gResolution.nextRenderScale();
+					}
 				}
 				
-				//Only draw when not minimized
-				if(!gWindow.isMinimized())
+				//Rebuild the cached scene once resizing settles
+				if(gResolution.update())
 				{
-									//Clear screen
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-				SDL_RenderClear(gRenderer);
+					if(!gSceneLayer.create(gResolution.getTargetWidth(), gResolution.getTargetHeight()))
+					{
+						printf("Failed to create scene layer!\n");
+						quit = true;
+					}
+				}
 				
-				//Render text textures
-				gSceneTexture.render((gWindow.getWidth() - gSceneTexture.getWidth())/2, (gWindow.getHeight() 
-					- gSceneTexture.getHeight())/2);
+				//Throttle to how visible the window is
+				LWindowActivity activity = gWindow.getActivity();
+				++gTicks[activity];
 				
-				//Update screen
-				SDL_RenderPresent(gRenderer);
+				//Only draw when visible and something changed
+				if(activity != WINDOW_ACTIVITY_HIDDEN && (present || gSceneLayer.isDirty()))
+				{
+					//Compose the scene centered in the layout
+					if(gSceneLayer.isDirty())
+					{
+						gSceneLayer.begin();
+						gResolution.beginLogical(gRenderer);
+						gSceneTexture.render((gResolution.getLogicalWidth() - gSceneTexture.getWidth())/2, (gResolution.getLogicalHeight() 
+							- gSceneTexture.getHeight())/2);
+						gResolution.endLogical(gRenderer);
+						gSceneLayer.end();
+					}
+					
+					//Clear screen
+					SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+					SDL_RenderClear(gRenderer);
+					
+					//Scale cached scene into the window
+					SDL_Rect output = gResolution.getOutputRect();
+					gSceneLayer.render(&output);
+					
+					//Update screen
+					SDL_RenderPresent(gRenderer);
+					present = false;
+					++gFrames[activity];
+				}
+				gBusyTicks += busyTimer.getTicks();
+				
+				//Idle without spinning, longer while the window is in the background, input still wakes it
+				delay = ACTIVITY_TICK_INTERVAL[activity];
+				if(delay == 0 && !present && !gSceneLayer.isDirty())
+				{
+					delay = IDLE_TIMEOUT;
 				}
+				
+				//Wake in time to rebuild the scene once resizing settles
+				delay = gResolution.getSettleDelay(delay);
 			}		
 		}
 	}
@@ -1,9 +1,11 @@
-//Using SDL, SDL_image, SDL_ttf, standard IO, strings, and string streams
+//Using SDL, SDL_image, SDL_ttf, standard IO, strings, string streams, vectors, and algorithms
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <stdio.h>
 #include <sstream>
+#include <vector>
+#include <algorithm>
 
 
 //Screen dimension constants
@@ -19,6 +21,54 @@ const int TOTAL_DATA = 10;
 //Total windows
 const int TOTAL_WINDOWS = 3; 
 
+//Most renderers a texture can be copied into, one per window
+const int MAX_RENDERERS = TOTAL_WINDOWS;
+
+//Milliseconds the window size must hold before render targets are rebuilt
+const Uint32 RESIZE_SETTLE_TIME = 200;
+
+//Fractions of the window resolution the scene can be rendered at
+const float RENDER_SCALES[] = { 1.0f, 0.75f, 0.5f };
+const int TOTAL_RENDER_SCALES = 3;
+
+//Refresh rate assumed when the display does not report one
+const int DEFAULT_REFRESH_RATE = 60;
+
+//Weight of the newest frame in the smoothed frame load
+const float FRAME_SMOOTHING = 0.1f;
+
+//Dynamic resolution limits, it drops fast and recovers slowly
+const float MIN_DYNAMIC_SCALE = 0.5f;
+const float DYNAMIC_STEP_DOWN = 0.05f;
+const float DYNAMIC_STEP_UP = 0.01f;
+
+//Present intervals over the vsync intervals they should take, above the first
+//vsyncs are being missed, below the second resolution rises
+const float DYNAMIC_MISSED_LOAD = 1.1f;
+const float DYNAMIC_ON_TIME_LOAD = 1.02f;
+
+//Full layout fills drawn by the heavy test scene
+const int HEAVY_LAYERS = 64;
+
+//How much a window is throttled
+enum LWindowActivity
+{
+	WINDOW_ACTIVITY_FOCUSED = 0,
+	WINDOW_ACTIVITY_BACKGROUND = 1,
+	WINDOW_ACTIVITY_HIDDEN = 2,
+	WINDOW_ACTIVITY_TOTAL = 3
+};
+
+//Milliseconds between ticks at each activity, focused windows draw every pass
+//and hidden windows never draw but still wake the loop for updates
+const Uint32 ACTIVITY_TICK_INTERVAL[WINDOW_ACTIVITY_TOTAL] = { 0, 100, 250 };
+
+//Milliseconds of simulation per dot step, independent of how often the loop wakes
+const Uint32 SIMULATION_STEP = 1000 / 60;
+
+//Most steps caught up in one pass, the rest is dropped after a long stall
+const Uint32 MAX_SIMULATION_STEPS = 30;
+
 //A circle structure
 struct Circle
 {
@@ -63,13 +113,67 @@ class LTexture
 		int getWidth();
 		int getHeight();
 
+		//Gets the copy of the texture belonging to a renderer, uploading it on first use
+		SDL_Texture* getTexture( SDL_Renderer* renderer );
+
+		//Destroys the copy belonging to a renderer slot
+		void releaseRenderer( int slot );
+
 	private:
-		//The actual hardware texture
-		SDL_Texture* mTexture;
+		//Decoded pixels, kept so any window's renderer can get a copy
+		SDL_Surface* mSurface;
+
+		//Hardware textures, one per renderer slot
+		SDL_Texture* mTextures[ MAX_RENDERERS ];
+
+		//Modulation applied to every copy
+		Uint8 mRed, mGreen, mBlue, mAlpha;
+		SDL_BlendMode mBlendMode;
 
 		//Image dimensions
 		int mWidth;
 		int mHeight;
+
+		//Takes ownership of loaded pixels
+		bool setSurface( SDL_Surface* surface );
+};
+
+//Tracks window renderers and the textures that have copies in them
+class LResourceContext
+{
+	public:
+		//Initializes internals
+		LResourceContext();
+
+		//Registers a window renderer, returns its slot or -1 when full
+		int addRenderer(SDL_Renderer* renderer);
+
+		//Drops every texture copy made for a renderer before it is destroyed
+		void removeRenderer(SDL_Renderer* renderer);
+
+		//Gets the slot of a registered renderer, -1 if unknown
+		int getSlot(SDL_Renderer* renderer);
+
+		//Tracks textures that may hold renderer copies
+		void addTexture(LTexture* texture);
+		void removeTexture(LTexture* texture);
+
+		//Counts texture uploads
+		void countUpload();
+
+		//Resource statistics
+		int getTextureCount();
+		int getUploadCount();
+
+	private:
+		//Registered renderers by slot
+		SDL_Renderer* mRenderers[MAX_RENDERERS];
+
+		//Loaded textures
+		std::vector<LTexture*> mTextures;
+
+		//Total texture uploads
+		int mUploads;
 };
 
 //The application time based timer
@@ -141,6 +245,83 @@ class Dot
 		void shiftColliders();
 };
 
+//Maps a fixed logical layout onto a resizable window through a render target
+class LResolution
+{
+	public:
+		//Initializes variables
+		LResolution();
+		
+		//Sets the layout size and the starting window size
+		void init(int logicalWidth, int logicalHeight, int windowWidth, int windowHeight);
+		
+		//Tracks a window size change, the target is rebuilt once resizing settles
+		void resize(int windowWidth, int windowHeight);
+		
+		//Switches to the next render scale
+		void nextRenderScale();
+		
+		//Returns true once when the render target needs rebuilding
+		bool update();
+		
+		//Switches frame time driven scaling on or off
+		void setDynamic(bool dynamic);
+		bool isDynamic();
+		
+		//Adjusts the dynamic scale from the time between presents against the time vsync allows
+		void adjust(float presentTime, float vsyncTime);
+		
+		//Maps logical coordinates onto the bound render target
+		void beginLogical(SDL_Renderer* renderer);
+		
+		//Restores pixel coordinates
+		void endLogical(SDL_Renderer* renderer);
+		
+		//Gets layout dimensions
+		int getLogicalWidth();
+		int getLogicalHeight();
+		
+		//Gets render target dimensions
+		int getTargetWidth();
+		int getTargetHeight();
+		
+		//Gets the part of the render target the scene is drawn into
+		SDL_Rect getSourceRect();
+		
+		//Gets the letterboxed window area the target is shown in
+		SDL_Rect getOutputRect();
+		
+	private:
+		//Layout dimensions
+		int mLogicalWidth;
+		int mLogicalHeight;
+		
+		//Window area the layout is scaled into
+		SDL_Rect mOutput;
+		
+		//Render target dimensions
+		int mTargetWidth;
+		int mTargetHeight;
+		
+		//Current entry in RENDER_SCALES
+		int mScaleIndex;
+		
+		//Resize bookkeeping
+		bool mResizePending;
+		Uint32 mResizeTime;
+		bool mTargetStale;
+		
+		//Fraction of the target drawn into when scaling dynamically
+		bool mDynamic;
+		float mDynamicScale;
+		
+		//Smoothed present interval over vsync interval
+		float mFrameLoad;
+		
+		//Recalculates the target size for the current output area
+		void updateTargetSize();
+};
+
 class LWindow
 {
 	public:
@@ -166,17 +347,47 @@ class LWindow
 		int getWidth();
 		int getHeight();
 		
+		//Window identifier events are tagged with
+		Uint32 getWindowID();
+		
 		//Window focii
 		bool hasMouseFocus();
 		bool hasKeyboardFocus();
 		bool isMinimized();
 		bool isShown();
 		
+		//Gets how much the window is throttled
+		LWindowActivity getActivity();
+		
+		//Milliseconds until the window wants another tick
+		Uint32 getWaitTime(Uint32 now);
+		
+		//Prints the frames drawn and skipped at each activity
+		void printActivity(int index);
+		
 	private:
 		//Window Data
 		SDL_Window* mWindow;
 		SDL_Renderer* mRenderer;
-		int mWindowID;
+		Uint32 mWindowID;
+		
+		//Scene target scaled into the window
+		LResolution mResolution;
+		SDL_Texture* mTarget;
+		
+		//Performance counter at the last present and the total presents then, 0 after a throttled frame
+		Uint64 mLastPresent;
+		Uint32 mLastPresentCount;
+		
+		//Milliseconds between vsyncs on the window's display
+		float mRefreshPeriod;
+		
+		//When the window last drew
+		Uint32 mLastFrameTime;
+		
+		//Frames drawn and skipped at each activity
+		Uint32 mFrames[WINDOW_ACTIVITY_TOTAL];
+		Uint32 mSkippedFrames[WINDOW_ACTIVITY_TOTAL];
 		
 		//Window dimensions
 		int mWidth;
@@ -190,6 +401,31 @@ class LWindow
 		bool mShown;
 };
 
+//Sends events straight to the window they belong to
+class LEventRouter
+{
+	public:
+		//Adds a window under its identifier
+		void addWindow(Uint32 windowID, LWindow* window);
+		
+		//Removes a window
+		void removeWindow(Uint32 windowID);
+		
+		//Finds the window with an identifier, NULL if none
+		LWindow* find(Uint32 windowID);
+		
+		//Gives a window tagged event to its window, returns false for global events
+		bool route(SDL_Event& e);
+		
+		//Gets the window an event is tagged with, 0 if none
+		static Uint32 getEventWindowID(SDL_Event& e);
+		
+	private:
+		//Windows sorted by identifier
+		typedef std::pair<Uint32, LWindow*> Route;
+		std::vector<Route> mRoutes;
+};
+
 //Starts up SDL and creates window
 bool init();
 
@@ -208,6 +444,9 @@ bool checkCollision(Circle& a, SDL_Rect& b);
 //Calculates distance squared between two points
 double distanceSquared(int x1, int y1, int x2, int y2);
 
+//Renderers and the textures shared between them
+LResourceContext gResources;
+
 //Globally used font
 TTF_Font* gFont = NULL;
 
@@ -222,16 +461,43 @@ Sint32 gData[TOTAL_DATA];
 //Our custom window
 LWindow gWindows[TOTAL_WINDOWS];
 
-//The window renderer
+//Window event dispatcher
+LEventRouter gRouter;
+
+//The renderer of the window currently being drawn
 SDL_Renderer* gRenderer = NULL;
 
 //Scene textures
 LTexture gSceneTexture;
+LTexture gDotTexture;
+
+//The dot shown in every window
+Dot gDot;
+
+//Whether the windows draw the heavy test scene
+bool gHeavyScene = false;
+
+//Loop activity counters
+Uint32 gUpdates = 0;
+Uint32 gBusyTicks = 0;
+Uint32 gIdleTicks = 0;
+
+//Presents across all windows, each waits for its own vsync
+Uint32 gPresents = 0;
 
 LTexture::LTexture()
 {
 	//Initialize
-	mTexture = NULL;
+	mSurface = NULL;
+	for( int i = 0; i < MAX_RENDERERS; ++i )
+	{
+		mTextures[ i ] = NULL;
+	}
+	mRed = 0xFF;
+	mGreen = 0xFF;
+	mBlue = 0xFF;
+	mAlpha = 0xFF;
+	mBlendMode = SDL_BLENDMODE_BLEND;
 	mWidth = 0;
 	mHeight = 0;
 }
@@ -247,40 +513,19 @@ bool LTexture::loadFromFile( std::string path )
 	//Get rid of preexisting texture
 	free();
 
-	//The final texture
-	SDL_Texture* newTexture = NULL;
-
 	//Load image at specified path
 	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
 	if( loadedSurface == NULL )
 	{
 		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
+		return false;
 	}
-	else
-	{
-		//Color key image
-		SDL_SetColorKey( loadedSurface, SDL_TRUE, SDL_MapRGB( loadedSurface->format, 0, 0xFF, 0xFF ) );
-
-		//Create texture from surface pixels
-        newTexture = SDL_CreateTextureFromSurface( gRenderer, loadedSurface );
-		if( newTexture == NULL )
-		{
-			printf( "Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
-		}
-		else
-		{
-			//Get image dimensions
-			mWidth = loadedSurface->w;
-			mHeight = loadedSurface->h;
-		}
 
-		//Get rid of old loaded surface
-		SDL_FreeSurface( loadedSurface );
-	}
+	//Color key image
+	SDL_SetColorKey( loadedSurface, SDL_TRUE, SDL_MapRGB( loadedSurface->format, 0, 0xFF, 0xFF ) );
 
-	//Return success
-	mTexture = newTexture;
-	return mTexture != NULL;
+	//Keep the pixels, each window uploads its own copy when it first draws them
+	return setSurface( loadedSurface );
 }
 
 #ifdef _SDL_TTF_H
@@ -291,42 +536,81 @@ bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColo
 	
 	//Render text surface
 	SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
-	if( textSurface != NULL )
+	if( textSurface == NULL )
 	{
-		//Create texture from surface pixels
-        mTexture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
-		if( mTexture == NULL )
-		{
-			printf( "Unable to create texture from rendered text! SDL Error: %s\n", SDL_GetError() );
-		}
-		else
+		printf( "Unable to render text surface! SDL_ttf Error: %s\n", TTF_GetError() );
+		return false;
+	}
+	
+	//Keep the pixels, each window uploads its own copy when it first draws them
+	return setSurface( textSurface );
+}
+#endif
+
+bool LTexture::setSurface( SDL_Surface* surface )
+{
+	//Get image dimensions
+	mSurface = surface;
+	mWidth = surface->w;
+	mHeight = surface->h;
+
+	//Let window renderers drop their copies when they close
+	gResources.addTexture( this );
+	return true;
+}
+
+SDL_Texture* LTexture::getTexture( SDL_Renderer* renderer )
+{
+	//Find which window the renderer belongs to
+	int slot = gResources.getSlot( renderer );
+	if( slot < 0 || mSurface == NULL )
+	{
+		return NULL;
+	}
+
+	//Upload the pixels the first time this renderer draws them
+	if( mTextures[ slot ] == NULL )
+	{
+		mTextures[ slot ] = SDL_CreateTextureFromSurface( renderer, mSurface );
+		if( mTextures[ slot ] == NULL )
 		{
-			//Get image dimensions
-			mWidth = textSurface->w;
-			mHeight = textSurface->h;
+			printf( "Unable to create texture copy! SDL Error: %s\n", SDL_GetError() );
+			return NULL;
 		}
 
-		//Get rid of old surface
-		SDL_FreeSurface( textSurface );
+		//Carry the modulation over to the new copy
+		SDL_SetTextureColorMod( mTextures[ slot ], mRed, mGreen, mBlue );
+		SDL_SetTextureAlphaMod( mTextures[ slot ], mAlpha );
+		SDL_SetTextureBlendMode( mTextures[ slot ], mBlendMode );
+		gResources.countUpload();
 	}
-	else
+
+	return mTextures[ slot ];
+}
+
+void LTexture::releaseRenderer( int slot )
+{
+	//Free the copy if it exists
+	if( mTextures[ slot ] != NULL )
 	{
-		printf( "Unable to render text surface! SDL_ttf Error: %s\n", TTF_GetError() );
+		SDL_DestroyTexture( mTextures[ slot ] );
+		mTextures[ slot ] = NULL;
 	}
-	
-	
-	//Return success
-	return mTexture != NULL;
 }
-#endif
 
 void LTexture::free()
 {
-	//Free texture if it exists
-	if( mTexture != NULL )
+	//Free the copies and the pixels if they exist
+	if( mSurface != NULL )
 	{
-		SDL_DestroyTexture( mTexture );
-		mTexture = NULL;
+		for( int i = 0; i < MAX_RENDERERS; ++i )
+		{
+			releaseRenderer( i );
+		}
+		gResources.removeTexture( this );
+
+		SDL_FreeSurface( mSurface );
+		mSurface = NULL;
 		mWidth = 0;
 		mHeight = 0;
 	}
@@ -335,23 +619,53 @@ void LTexture::free()
 void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue )
 {
 	//Modulate texture rgb
-	SDL_SetTextureColorMod( mTexture, red, green, blue );
+	mRed = red;
+	mGreen = green;
+	mBlue = blue;
+	for( int i = 0; i < MAX_RENDERERS; ++i )
+	{
+		if( mTextures[ i ] != NULL )
+		{
+			SDL_SetTextureColorMod( mTextures[ i ], red, green, blue );
+		}
+	}
 }
 
 void LTexture::setBlendMode( SDL_BlendMode blending )
 {
 	//Set blending function
-	SDL_SetTextureBlendMode( mTexture, blending );
+	mBlendMode = blending;
+	for( int i = 0; i < MAX_RENDERERS; ++i )
+	{
+		if( mTextures[ i ] != NULL )
+		{
+			SDL_SetTextureBlendMode( mTextures[ i ], blending );
+		}
+	}
 }
 		
 void LTexture::setAlpha( Uint8 alpha )
 {
 	//Modulate texture alpha
-	SDL_SetTextureAlphaMod( mTexture, alpha );
+	mAlpha = alpha;
+	for( int i = 0; i < MAX_RENDERERS; ++i )
+	{
+		if( mTextures[ i ] != NULL )
+		{
+			SDL_SetTextureAlphaMod( mTextures[ i ], alpha );
+		}
+	}
 }
 
 void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip )
 {
+	//Get the copy for the window being drawn
+	SDL_Texture* texture = getTexture( gRenderer );
+	if( texture == NULL )
+	{
+		return;
+	}
+
 	//Set rendering space and render to screen
 	SDL_Rect renderQuad = { x, y, mWidth, mHeight };
 
@@ -363,7 +677,7 @@ void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* ce
 	}
 
 	//Render to screen
-	SDL_RenderCopyEx( gRenderer, mTexture, clip, &renderQuad, angle, center, flip );
+	SDL_RenderCopyEx( gRenderer, texture, clip, &renderQuad, angle, center, flip );
 }
 
 int LTexture::getWidth()
@@ -376,6 +690,100 @@ int LTexture::getHeight()
 	return mHeight;
 }
 
+LResourceContext::LResourceContext()
+{
+	//Initialize
+	for(int i = 0; i < MAX_RENDERERS; ++i)
+	{
+		mRenderers[i] = NULL;
+	}
+	mUploads = 0;
+}
+
+int LResourceContext::addRenderer(SDL_Renderer* renderer)
+{
+	//Take the first free slot
+	for(int i = 0; i < MAX_RENDERERS; ++i)
+	{
+		if(mRenderers[i] == NULL)
+		{
+			mRenderers[i] = renderer;
+			return i;
+		}
+	}
+
+	printf("Too many renderers to share textures with!\n");
+	return -1;
+}
+
+void LResourceContext::removeRenderer(SDL_Renderer* renderer)
+{
+	int slot = getSlot(renderer);
+	if(slot < 0)
+	{
+		return;
+	}
+
+	//Copies die with their renderer so free them first
+	for(size_t i = 0; i < mTextures.size(); ++i)
+	{
+		mTextures[i]->releaseRenderer(slot);
+	}
+	mRenderers[slot] = NULL;
+}
+
+int LResourceContext::getSlot(SDL_Renderer* renderer)
+{
+	if(renderer == NULL)
+	{
+		return -1;
+	}
+
+	for(int i = 0; i < MAX_RENDERERS; ++i)
+	{
+		if(mRenderers[i] == renderer)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void LResourceContext::addTexture(LTexture* texture)
+{
+	mTextures.push_back(texture);
+}
+
+void LResourceContext::removeTexture(LTexture* texture)
+{
+	//Swap with the last texture and drop it
+	for(size_t i = 0; i < mTextures.size(); ++i)
+	{
+		if(mTextures[i] == texture)
+		{
+			mTextures[i] = mTextures.back();
+			mTextures.pop_back();
+			break;
+		}
+	}
+}
+
+void LResourceContext::countUpload()
+{
+	++mUploads;
+}
+
+int LResourceContext::getTextureCount()
+{
+	return mTextures.size();
+}
+
+int LResourceContext::getUploadCount()
+{
+	return mUploads;
+}
+
 LTimer::LTimer()
 {
     //Initialize the variables
@@ -542,8 +950,8 @@ void Dot::move()
 
 void Dot::render()
 {
-	//Show the dot relative to the camera
-	//gDotTexture.render(mPosX, mPosY);
+	//Show the dot in the window being drawn
+	gDotTexture.render(mPosX, mPosY);
 }
 
 void Dot::shiftColliders()
@@ -553,10 +961,219 @@ void Dot::shiftColliders()
 	mCollider.y = mPosY;
 }
 
+LResolution::LResolution()
+{
+	//Initialize
+	mLogicalWidth = 0;
+	mLogicalHeight = 0;
+	mOutput.x = 0;
+	mOutput.y = 0;
+	mOutput.w = 0;
+	mOutput.h = 0;
+	mTargetWidth = 0;
+	mTargetHeight = 0;
+	mScaleIndex = 0;
+	mResizePending = false;
+	mResizeTime = 0;
+	mTargetStale = false;
+	mDynamic = true;
+	mDynamicScale = 1.0f;
+	mFrameLoad = 1.0f;
+}
+
+void LResolution::init(int logicalWidth, int logicalHeight, int windowWidth, int windowHeight)
+{
+	mLogicalWidth = logicalWidth;
+	mLogicalHeight = logicalHeight;
+	resize(windowWidth, windowHeight);
+	
+	//No need to wait for the first target
+	mResizePending = false;
+	updateTargetSize();
+}
+
+void LResolution::resize(int windowWidth, int windowHeight)
+{
+	//Fit the largest area with the layout's aspect ratio
+	if(windowWidth * mLogicalHeight > windowHeight * mLogicalWidth)
+	{
+		mOutput.h = windowHeight;
+		mOutput.w = windowHeight * mLogicalWidth / mLogicalHeight;
+	}
+	else
+	{
+		mOutput.w = windowWidth;
+		mOutput.h = windowWidth * mLogicalHeight / mLogicalWidth;
+	}
+	mOutput.x = (windowWidth - mOutput.w) / 2;
+	mOutput.y = (windowHeight - mOutput.h) / 2;
+	
+	//The old target is stretched over the new area until resizing stops
+	mResizePending = true;
+	mResizeTime = SDL_GetTicks();
+}
+
+void LResolution::nextRenderScale()
+{
+	//Scale changes are applied straight away
+	mScaleIndex = (mScaleIndex + 1) % TOTAL_RENDER_SCALES;
+	updateTargetSize();
+}
+
+bool LResolution::update()
+{
+	//Wait until the window size has held for a while
+	if(mResizePending && SDL_GetTicks() - mResizeTime >= RESIZE_SETTLE_TIME)
+	{
+		mResizePending = false;
+		updateTargetSize();
+	}
+	
+	bool stale = mTargetStale;
+	mTargetStale = false;
+	return stale;
+}
+
+void LResolution::setDynamic(bool dynamic)
+{
+	//Start over at full resolution
+	mDynamic = dynamic;
+	mDynamicScale = 1.0f;
+	mFrameLoad = 1.0f;
+}
+
+bool LResolution::isDynamic()
+{
+	return mDynamic;
+}
+
+void LResolution::adjust(float presentTime, float vsyncTime)
+{
+	if(!mDynamic || vsyncTime <= 0.0f)
+	{
+		return;
+	}
+	
+	//Smooth out single slow frames
+	mFrameLoad = mFrameLoad * (1.0f - FRAME_SMOOTHING) + presentTime / vsyncTime * FRAME_SMOOTHING;
+	
+	//Drop resolution while vsyncs are missed, win it back slowly while frames are on time
+	if(mFrameLoad > DYNAMIC_MISSED_LOAD)
+	{
+		mDynamicScale -= DYNAMIC_STEP_DOWN;
+	}
+	else if(mFrameLoad < DYNAMIC_ON_TIME_LOAD)
+	{
+		mDynamicScale += DYNAMIC_STEP_UP;
+	}
+	
+	if(mDynamicScale < MIN_DYNAMIC_SCALE)
+	{
+		mDynamicScale = MIN_DYNAMIC_SCALE;
+	}
+	else if(mDynamicScale > 1.0f)
+	{
+		mDynamicScale = 1.0f;
+	}
+}
+
+void LResolution::beginLogical(SDL_Renderer* renderer)
+{
+	SDL_Rect source = getSourceRect();
+	SDL_RenderSetScale(renderer, (float)source.w / mLogicalWidth, (float)source.h / mLogicalHeight);
+}
+
+void LResolution::endLogical(SDL_Renderer* renderer)
+{
+	SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+}
+
+int LResolution::getLogicalWidth()
+{
+	return mLogicalWidth;
+}
+
+int LResolution::getLogicalHeight()
+{
+	return mLogicalHeight;
+}
+
+int LResolution::getTargetWidth()
+{
+	return mTargetWidth;
+}
+
+int LResolution::getTargetHeight()
+{
+	return mTargetHeight;
+}
+
+SDL_Rect LResolution::getSourceRect()
+{
+	//The target keeps its size, only the corner drawn into shrinks
+	SDL_Rect source = { 0, 0, mTargetWidth, mTargetHeight };
+	if(mDynamic)
+	{
+		source.w = (int)(mTargetWidth * mDynamicScale);
+		source.h = (int)(mTargetHeight * mDynamicScale);
+		if(source.w < 1)
+		{
+			source.w = 1;
+		}
+		if(source.h < 1)
+		{
+			source.h = 1;
+		}
+	}
+	
+	return source;
+}
+
+SDL_Rect LResolution::getOutputRect()
+{
+	return mOutput;
+}
+
+void LResolution::updateTargetSize()
+{
+	//Render below the output resolution and let the copy to the window upscale
+	int width = (int)(mOutput.w * RENDER_SCALES[mScaleIndex]);
+	int height = (int)(mOutput.h * RENDER_SCALES[mScaleIndex]);
+	if(width < 1)
+	{
+		width = 1;
+	}
+	if(height < 1)
+	{
+		height = 1;
+	}
+	
+	//Only rebuild when the size actually changed
+	if(width != mTargetWidth || height != mTargetHeight)
+	{
+		mTargetWidth = width;
+		mTargetHeight = height;
+		mTargetStale = true;
+	}
+}
+
 LWindow::LWindow()
 {
 	//Initialize non-existant window
 	mWindow = NULL;
+	mRenderer = NULL;
+	mWindowID = 0;
+	mTarget = NULL;
+	mShown = false;
+	mLastFrameTime = 0;
+	mLastPresent = 0;
+	mLastPresentCount = 0;
+	mRefreshPeriod = 1000.0f / DEFAULT_REFRESH_RATE;
+	for(int i = 0; i < WINDOW_ACTIVITY_TOTAL; ++i)
+	{
+		mFrames[i] = 0;
+		mSkippedFrames[i] = 0;
+	}
 	mMouseFocus = false;
 	mKeyboardFocus = false;
 	mFullScreen = false;
@@ -578,7 +1195,7 @@ bool LWindow::init()
 		mHeight = SCREEN_HEIGHT;
 		
 		//Create renderer for window
-		mRenderer = SDL_CreateRenderer(mWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+		mRenderer = SDL_CreateRenderer(mWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 		if(mRenderer == NULL)
 		{
 			printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
@@ -590,8 +1207,22 @@ bool LWindow::init()
 			//Initialize renderer color
 			SDL_SetRenderDrawColor(mRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 			
-			//Grab window identifier
+			//Lay the scene out at the starting window size
+			mResolution.init(LEVEL_WIDTH, LEVEL_HEIGHT, mWidth, mHeight);
+			
+			//Vsync interval dynamic resolution is held to
+			SDL_DisplayMode mode;
+			if(SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(mWindow), &mode) == 0 && mode.refresh_rate > 0)
+			{
+				mRefreshPeriod = 1000.0f / mode.refresh_rate;
+			}
+			
+			//Grab window identifier and receive its events
 			mWindowID = SDL_GetWindowID(mWindow);
+			gRouter.addWindow(mWindowID, this);
+			
+			//Share loaded textures with this renderer
+			gResources.addRenderer(mRenderer);
 			
 			//Flag as opened
 			mShown = true;
@@ -607,8 +1238,8 @@ bool LWindow::init()
 
 void LWindow::handleEvent(SDL_Event& e)
 {
-	//If an event was detected for this window
-	if(e.type == SDL_WINDOWEVENT && e.window.windowID == mWindowID)
+	//Only this window's events are routed here
+	if(e.type == SDL_WINDOWEVENT)
 	{
 		//Caption update flag
 		bool updateCaption = false;
@@ -624,16 +1255,11 @@ void LWindow::handleEvent(SDL_Event& e)
 				mShown = false;
 				break;
 			
-			//Get new dimensions and repaint on window size change
+			//Get new dimensions on window size change, the next frame repaints
 			case SDL_WINDOWEVENT_SIZE_CHANGED:
 				mWidth = e.window.data1;
 				mHeight = e.window.data2;
-				SDL_RenderPresent(gRenderer);
-				break;
-				
-			//Repaint on exposure
-			case SDL_WINDOWEVENT_EXPOSED:
-				SDL_RenderPresent(gRenderer);
+				mResolution.resize(mWidth, mHeight);
 				break;
 			
 			//Mouse entered window
@@ -704,7 +1330,17 @@ void LWindow::handleEvent(SDL_Event& e)
 			mFullScreen = true;
 			mMinimized = false;
 		}
-	}		
+	}
+	//Cycle the render resolution on r
+	else if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_r)
+	{
+		mResolution.nextRenderScale();
+	}
+	//Toggle dynamic resolution on d
+	else if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_d)
+	{
+		mResolution.setDynamic(!mResolution.isDynamic());
+	}
 }
 
 int LWindow::getWidth()
@@ -717,6 +1353,11 @@ int LWindow::getHeight()
 	return mHeight;
 }
 
+Uint32 LWindow::getWindowID()
+{
+	return mWindowID;
+}
+
 bool LWindow::hasMouseFocus()
 {
 	return mMouseFocus;
@@ -737,11 +1378,61 @@ bool LWindow::isShown()
 	return mShown;
 }
 
+LWindowActivity LWindow::getActivity()
+{
+	if(!mShown || mMinimized)
+	{
+		return WINDOW_ACTIVITY_HIDDEN;
+	}
+	
+	return mKeyboardFocus ? WINDOW_ACTIVITY_FOCUSED : WINDOW_ACTIVITY_BACKGROUND;
+}
+
+Uint32 LWindow::getWaitTime(Uint32 now)
+{
+	LWindowActivity activity = getActivity();
+	Uint32 interval = ACTIVITY_TICK_INTERVAL[activity];
+	if(activity == WINDOW_ACTIVITY_HIDDEN)
+	{
+		return interval;
+	}
+	
+	//Due once the interval since the last frame has passed
+	Uint32 elapsed = now - mLastFrameTime;
+	return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+void LWindow::printActivity(int index)
+{
+	printf("Window %d: %u focused, %u background frames drawn, %u throttled, %u skipped while hidden\n", index, 
+		mFrames[WINDOW_ACTIVITY_FOCUSED], mFrames[WINDOW_ACTIVITY_BACKGROUND], mSkippedFrames[WINDOW_ACTIVITY_BACKGROUND], 
+		mSkippedFrames[WINDOW_ACTIVITY_HIDDEN]);
+}
+
 void LWindow::free()
 {
+	if( mTarget != NULL )
+	{
+		SDL_DestroyTexture( mTarget );
+		mTarget = NULL;
+	}
+
+	if( mRenderer != NULL )
+	{
+		//Texture copies go before their renderer
+		gResources.removeRenderer( mRenderer );
+		SDL_DestroyRenderer( mRenderer );
+		mRenderer = NULL;
+	}
+
 	if( mWindow != NULL )
 	{
+		//Stop receiving events
+		gRouter.removeWindow( mWindowID );
+		
 		SDL_DestroyWindow( mWindow );
+		mWindow = NULL;
+		mWindowID = 0;
 	}
 
 	mMouseFocus = false;
@@ -764,17 +1455,170 @@ void LWindow::focus()
 
 void LWindow::render()
 {
-	if(!mMinimized)
+	//Hidden windows are only updated and throttled ones draw less often
+	LWindowActivity activity = getActivity();
+	if(activity == WINDOW_ACTIVITY_HIDDEN || getWaitTime(SDL_GetTicks()) > 0)
 	{
-		//Clear screen
-		SDL_SetRenderDrawColor(mRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-		SDL_RenderClear(mRenderer);
-		
-		//Update screen
-		SDL_RenderPresent(mRenderer);
+		++mSkippedFrames[activity];
+		return;
+	}
+	mLastFrameTime = SDL_GetTicks();
+	++mFrames[activity];
+	
+	//Textures draw into this window
+	gRenderer = mRenderer;
+	
+	//Rebuild the scene target once resizing settles
+	if(mResolution.update() || mTarget == NULL)
+	{
+		if(mTarget != NULL)
+		{
+			SDL_DestroyTexture(mTarget);
+		}
+		mTarget = SDL_CreateTexture(mRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, 
+			mResolution.getTargetWidth(), mResolution.getTargetHeight());
+		if(mTarget == NULL)
+		{
+			printf("Unable to create window scene target! SDL Error: %s\n", SDL_GetError());
+			return;
+		}
+	}
+	
+	//Draw the scene in layout coordinates
+	SDL_SetRenderTarget(mRenderer, mTarget);
+	mResolution.beginLogical(mRenderer);
+	SDL_SetRenderDrawColor(mRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_RenderClear(mRenderer);
+	
+	//Stand in for an expensive scene, cost grows with the pixels drawn
+	if(gHeavyScene)
+	{
+		SDL_Rect layout = { 0, 0, LEVEL_WIDTH, LEVEL_HEIGHT };
+		SDL_SetRenderDrawBlendMode(mRenderer, SDL_BLENDMODE_BLEND);
+		SDL_SetRenderDrawColor(mRenderer, 0x00, 0x80, 0xFF, 0x04);
+		for(int i = 0; i < HEAVY_LAYERS; ++i)
+		{
+			SDL_RenderFillRect(mRenderer, &layout);
+		}
+		SDL_SetRenderDrawBlendMode(mRenderer, SDL_BLENDMODE_NONE);
+	}
+	
+	gDot.render();
+	mResolution.endLogical(mRenderer);
+	SDL_SetRenderTarget(mRenderer, NULL);
+	
+	//Clear screen
+	SDL_SetRenderDrawColor(mRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_RenderClear(mRenderer);
+	
+	//Upscale the drawn part of the target into the window
+	SDL_Rect source = mResolution.getSourceRect();
+	SDL_Rect output = mResolution.getOutputRect();
+	SDL_RenderCopy(mRenderer, mTarget, &source, &output);
+	
+	//Update screen
+	SDL_RenderPresent(mRenderer);
+	++gPresents;
+	
+	//Pick the resolution of the next frame from the whole present to present interval, GPU work and
+	//missed vsyncs included. Every present in between, this window's and the others', should take one vsync
+	Uint64 now = SDL_GetPerformanceCounter();
+	if(activity == WINDOW_ACTIVITY_FOCUSED && mLastPresent != 0)
+	{
+		float presentTime = 1000.0f * (now - mLastPresent) / SDL_GetPerformanceFrequency();
+		mResolution.adjust(presentTime, mRefreshPeriod * (gPresents - mLastPresentCount));
+	}
+	
+	//Throttled windows wait on purpose so their intervals say nothing about load
+	mLastPresent = activity == WINDOW_ACTIVITY_FOCUSED ? now : 0;
+	mLastPresentCount = gPresents;
+}
+
+void LEventRouter::addWindow(Uint32 windowID, LWindow* window)
+{
+	//Keep the routes sorted so lookups are a binary search
+	Route route(windowID, window);
+	std::vector<Route>::iterator it = std::lower_bound(mRoutes.begin(), mRoutes.end(), route);
+	if(it != mRoutes.end() && it->first == windowID)
+	{
+		it->second = window;
+	}
+	else
+	{
+		mRoutes.insert(it, route);
+	}
+}
+
+void LEventRouter::removeWindow(Uint32 windowID)
+{
+	std::vector<Route>::iterator it = std::lower_bound(mRoutes.begin(), mRoutes.end(), Route(windowID, (LWindow*)NULL));
+	if(it != mRoutes.end() && it->first == windowID)
+	{
+		mRoutes.erase(it);
 	}
 }
 
+LWindow* LEventRouter::find(Uint32 windowID)
+{
+	std::vector<Route>::iterator it = std::lower_bound(mRoutes.begin(), mRoutes.end(), Route(windowID, (LWindow*)NULL));
+	if(it != mRoutes.end() && it->first == windowID)
+	{
+		return it->second;
+	}
+	
+	return NULL;
+}
+
+bool LEventRouter::route(SDL_Event& e)
+{
+	//Events not tagged with a window are for everyone
+	Uint32 windowID = getEventWindowID(e);
+	if(windowID == 0)
+	{
+		return false;
+	}
+	
+	//Only the window the event belongs to sees it
+	LWindow* window = find(windowID);
+	if(window != NULL)
+	{
+		window->handleEvent(e);
+	}
+	
+	return true;
+}
+
+Uint32 LEventRouter::getEventWindowID(SDL_Event& e)
+{
+	switch(e.type)
+	{
+		case SDL_WINDOWEVENT:
+			return e.window.windowID;
+			
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			return e.key.windowID;
+			
+		case SDL_TEXTEDITING:
+			return e.edit.windowID;
+			
+		case SDL_TEXTINPUT:
+			return e.text.windowID;
+			
+		case SDL_MOUSEMOTION:
+			return e.motion.windowID;
+			
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			return e.button.windowID;
+			
+		case SDL_MOUSEWHEEL:
+			return e.wheel.windowID;
+	}
+	
+	return 0;
+}
+
 bool init()
 {
 	//Initialization flag
@@ -830,11 +1674,32 @@ bool loadMedia()
 	//Loading success flag
 	bool success = true;
 	
+	//Load dot texture once, windows upload it when they first draw it
+	if(!gDotTexture.loadFromFile("dot.bmp"))
+	{
+		printf("Failed to load dot texture!\n");
+		success = false;
+	}
+	
 	return success;
 }
 
 void close()
 {
+	//Report how often pixels were uploaded
+	printf("%d textures loaded, %d renderer copies uploaded\n", gResources.getTextureCount(), gResources.getUploadCount());
+	
+	//Report how much work the throttling saved
+	printf("%u updates, %u ms busy, %u ms waiting\n", gUpdates, gBusyTicks, gIdleTicks);
+	for(int i = 0; i < TOTAL_WINDOWS; ++i)
+	{
+		gWindows[i].printActivity(i);
+	}
+	
+	//Free loaded images
+	gDotTexture.free();
+	gSceneTexture.free();
+	
 	//Destroy windows
 	for(int i = 0; i < TOTAL_WINDOWS; ++i)
 	{
@@ -948,11 +1813,29 @@ int wmain( int argc, char* args[] )
 			//Event handler
 			SDL_Event e;
 			
+			//Milliseconds to wait for events before the next tick
+			Uint32 timeout = 0;
+			
+			//Times waiting and working for the activity counters
+			LTimer idleTimer;
+			LTimer busyTimer;
+			
+			//Simulation clock and how much of it has been stepped
+			LTimer stepTimer;
+			Uint32 steppedTime = 0;
+			stepTimer.start();
+			
 			//While application is running
 			while(!quit)
 			{
+				//Sleep until an event arrives or a throttled window is due
+				idleTimer.start();
+				bool hasEvent = SDL_WaitEventTimeout(&e, timeout) != 0;
+				gIdleTicks += idleTimer.getTicks();
+				busyTimer.start();
+				
 				//Handle events on queue
-				while(SDL_PollEvent(&e) != 0)
+				for(; hasEvent; hasEvent = SDL_PollEvent(&e) != 0)
 				{
 					//User requests quit
 					if(e.type == SDL_QUIT)
@@ -961,10 +1844,10 @@ int wmain( int argc, char* args[] )
 					}
 					
 					//Handle window events
-					for(int i = 0; i < TOTAL_WINDOWS; ++i)		
-					{
-						gWindows[i].handleEvent(e);
-					}
+					gRouter.route(e);
+					
+					//Handle input for the dot
+					gDot.handleEvent(e);
 					
 					//Pull up window
 					if(e.type == SDL_KEYDOWN)
@@ -980,10 +1863,26 @@ int wmain( int argc, char* args[] )
 							case SDLK_3:
 								gWindows[2].focus();
 								break;
+							case SDLK_l:
+								gHeavyScene = !gHeavyScene;
+								break;
 						}
 					}
 				}
 				
+				//Move the dot in fixed steps for the time that passed
+				Uint32 steps = (stepTimer.getTicks() - steppedTime) / SIMULATION_STEP;
+				steppedTime += steps * SIMULATION_STEP;
+				if(steps > MAX_SIMULATION_STEPS)
+				{
+					steps = MAX_SIMULATION_STEPS;
+				}
+				for(Uint32 i = 0; i < steps; ++i)
+				{
+					gDot.move();
+					++gUpdates;
+				}
+				
 				//Update all windows
 				for(int i = 0; i < TOTAL_WINDOWS; ++i)
 				{
@@ -1006,6 +1905,19 @@ int wmain( int argc, char* args[] )
 				{
 					quit = true;
 				}
+				
+				//Wait for the window that is due soonest
+				Uint32 now = SDL_GetTicks();
+				timeout = ACTIVITY_TICK_INTERVAL[WINDOW_ACTIVITY_HIDDEN];
+				for(int i = 0; i < TOTAL_WINDOWS; ++i)
+				{
+					Uint32 wait = gWindows[i].getWaitTime(now);
+					if(wait < timeout)
+					{
+						timeout = wait;
+					}
+				}
+				gBusyTicks += busyTimer.getTicks();
 			}
 		}
 	}
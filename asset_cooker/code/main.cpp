@@ -0,0 +1,190 @@
+//Offline asset cooker, turns images into renderer ready texture containers
+//Usage: main.exe image.png [more images...] writes image.png.tex next to each image
+
+//Using SDL, SDL_image, standard IO, file status, strings, and wide strings
+#include <SDL.h>
+#include <SDL_image.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string>
+#include <wchar.h>
+
+//Cooked texture identifier, "LTEX" in file byte order
+const Uint32 COOKED_MAGIC = 0x5845544C;
+
+//Cooked container layout, bumped when the header changes
+const Uint32 COOKED_VERSION = 3;
+
+//Color key the lessons use, baked into the alpha channel
+const Uint8 KEY_RED = 0x00;
+const Uint8 KEY_GREEN = 0xFF;
+const Uint8 KEY_BLUE = 0xFF;
+
+//Header at the start of every cooked texture, followed by each mip level's
+//tightly packed rows, largest level first
+struct CookedHeader
+{
+	//Always COOKED_MAGIC
+	Uint32 magic;
+
+	//Always COOKED_VERSION
+	Uint32 version;
+
+	//Size and modification time of the image file, so loaders can tell when it changed
+	Uint32 sourceSize;
+	Uint32 sourceTime;
+
+	//SDL pixel format of the stored pixels
+	Uint32 format;
+
+	//Dimensions of the largest level
+	Sint32 width;
+	Sint32 height;
+
+	//Number of levels stored
+	Sint32 mipLevels;
+};
+
+//Cooks an image into a texture container
+bool cookImage(std::string imagePath, std::string cookedPath);
+
+//Gets a file's size and modification time, false if it doesn't exist
+bool getFileStamp(std::string path, Uint32& size, Uint32& modified);
+
+//Converts a command line argument to UTF-8
+std::string toUTF8(const wchar_t* text);
+
+bool cookImage(std::string imagePath, std::string cookedPath)
+{
+	//Load image at specified path
+	SDL_Surface* loadedSurface = IMG_Load(imagePath.c_str());
+	if(loadedSurface == NULL)
+	{
+		printf("Unable to load image %s! SDL_image Error: %s\n", imagePath.c_str(), IMG_GetError());
+		return false;
+	}
+
+	//Store pixels in the format the renderers take without converting
+	SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+	SDL_FreeSurface(loadedSurface);
+	if(formattedSurface == NULL)
+	{
+		printf("Unable to convert image %s! SDL Error: %s\n", imagePath.c_str(), SDL_GetError());
+		return false;
+	}
+
+	//Bake the color key so loading needs no per pixel work
+	Uint32 key = ((Uint32)KEY_RED << 16) | ((Uint32)KEY_GREEN << 8) | KEY_BLUE;
+	for(int y = 0; y < formattedSurface->h; ++y)
+	{
+		Uint32* row = (Uint32*)((Uint8*)formattedSurface->pixels + y * formattedSurface->pitch);
+		for(int x = 0; x < formattedSurface->w; ++x)
+		{
+			if((row[x] & 0x00FFFFFF) == key)
+			{
+				row[x] = 0;
+			}
+		}
+	}
+
+	//SDL's renderers only sample the base level so that is the only one stored
+	CookedHeader header;
+	header.magic = COOKED_MAGIC;
+	header.version = COOKED_VERSION;
+	header.sourceSize = 0;
+	header.sourceTime = 0;
+	getFileStamp(imagePath, header.sourceSize, header.sourceTime);
+	header.format = SDL_PIXELFORMAT_ARGB8888;
+	header.width = formattedSurface->w;
+	header.height = formattedSurface->h;
+	header.mipLevels = 1;
+
+	SDL_RWops* file = SDL_RWFromFile(cookedPath.c_str(), "wb");
+	if(file == NULL)
+	{
+		printf("Unable to create %s! SDL Error: %s\n", cookedPath.c_str(), SDL_GetError());
+		SDL_FreeSurface(formattedSurface);
+		return false;
+	}
+
+	//Write the header then the rows without padding
+	bool success = SDL_RWwrite(file, &header, sizeof(header), 1) == 1;
+	for(int y = 0; y < header.height && success; ++y)
+	{
+		success = SDL_RWwrite(file, (Uint8*)formattedSurface->pixels + y * formattedSurface->pitch, sizeof(Uint32), header.width) == (size_t)header.width;
+	}
+	if(!success)
+	{
+		printf("Unable to write %s! SDL Error: %s\n", cookedPath.c_str(), SDL_GetError());
+	}
+
+	SDL_RWclose(file);
+	SDL_FreeSurface(formattedSurface);
+	return success;
+}
+
+bool getFileStamp(std::string path, Uint32& size, Uint32& modified)
+{
+	struct stat status;
+	if(stat(path.c_str(), &status) != 0)
+	{
+		return false;
+	}
+
+	size = (Uint32)status.st_size;
+	modified = (Uint32)status.st_mtime;
+	return true;
+}
+
+std::string toUTF8(const wchar_t* text)
+{
+	//Windows command lines are UTF-16
+	char* converted = SDL_iconv_string("UTF-8", "UTF-16LE", (const char*)text, (wcslen(text) + 1) * sizeof(wchar_t));
+	if(converted == NULL)
+	{
+		return "";
+	}
+
+	std::string result = converted;
+	SDL_free(converted);
+	return result;
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	if(argc < 2)
+	{
+		printf("Usage: main.exe image.png [more images...]\n");
+		return 1;
+	}
+
+	//Initialize PNG loading
+	int imgFlags = IMG_INIT_PNG;
+	if(!(IMG_Init(imgFlags) & imgFlags))
+	{
+		printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+		return 1;
+	}
+
+	//Cook every image named on the command line
+	int failures = 0;
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string imagePath = toUTF8(argv[i]);
+		if(cookImage(imagePath, imagePath + ".tex"))
+		{
+			printf("Cooked %s\n", imagePath.c_str());
+		}
+		else
+		{
+			++failures;
+		}
+	}
+
+	//Quit SDL subsystems
+	IMG_Quit();
+	SDL_Quit();
+
+	return failures == 0 ? 0 : 1;
+}